@@ -7,26 +7,68 @@
 #include <map>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <iterator>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <ranges>
 
-template<typename K, typename V> requires std::totally_ordered<K> && std::regular<K> && std::copy_constructible<V>
+// Zachowanie ograniczonej kolejki przy wstawianiu do pełnej kolejki.
+enum class kvfifo_overflow {
+    reject,               // push zgłasza std::length_error, try_push zwraca false
+    drop_oldest,          // usuwany jest pierwszy element kolejki
+    drop_oldest_same_key  // usuwany jest najstarszy element o tym samym kluczu;
+                          // jeśli wstawiony element jest jedynym o swoim
+                          // kluczu, usuwany jest pierwszy element kolejki
+};
+
+template<typename K, typename V, typename Alloc = std::allocator<std::pair<K, V>>>
+requires std::totally_ordered<K> && std::regular<K> && std::copy_constructible<V>
 class kvfifo {
     private:
-        using listIterator = typename std::list<std::pair<K, V>>::iterator;
-        using mapIterator = typename std::map<K, std::list<listIterator>>;
-        std::shared_ptr<std::list<std::pair<K, V>>> elements;
-        std::shared_ptr<std::map<K, std::list<listIterator>>> keys;
+        template<typename T>
+        using rebindAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using elementList = std::list<std::pair<K, V>, Alloc>;
+        using listIterator = typename elementList::iterator;
+        using keyList = std::list<listIterator, rebindAlloc<listIterator>>;
+        using keyMap = std::map<K, keyList, std::less<K>, rebindAlloc<std::pair<K const, keyList>>>;
+        std::shared_ptr<elementList> elements;
+        std::shared_ptr<keyMap> keys;
         bool referenced = false;
+        size_t maxSize = std::numeric_limits<size_t>::max();
+        kvfifo_overflow overflow = kvfifo_overflow::reject;
+
+        // Węzły list, mapy i bloki kontrolne shared_ptr pochodzą z alokatora
+        // kolejki, który jest przechowywany w liście elementów.
+        Alloc allocator() const noexcept {
+            return elements->get_allocator();
+        }
+
+        static std::shared_ptr<elementList> newElements(Alloc const &alloc) {
+            return std::allocate_shared<elementList>(alloc, elementList(alloc));
+        }
+
+        static std::shared_ptr<keyMap> newKeys(Alloc const &alloc) {
+            return std::allocate_shared<keyMap>(alloc, keyMap(typename keyMap::allocator_type(alloc)));
+        }
+
+        keyList &keyIndex(K const &k) {
+            return keys->try_emplace(k, keyList(typename keyList::allocator_type(allocator()))).first->second;
+        }
 
         void makeCopy() {
-            std::shared_ptr<std::list<std::pair<K, V>>> oldElements = elements;
-            std::shared_ptr<std::map<K, std::list<listIterator>>> oldKeys = keys;
+            std::shared_ptr<elementList> oldElements = elements;
+            std::shared_ptr<keyMap> oldKeys = keys;
 
              try {
-                 elements = std::make_shared<std::list<std::pair<K, V>>>(*elements);
-                 keys = std::make_shared<std::map<K, std::list<listIterator>>>();
+                 Alloc alloc = allocator();
+                 elements = std::allocate_shared<elementList>(alloc, elementList(*elements, alloc));
+                 keys = newKeys(alloc);
                  listIterator it = (*elements).begin();
-                 for (std::pair<K, V> element : (*elements)) {
-                     (*keys)[element.first].push_back(it);
+                 for (std::pair<K, V> const &element : (*elements)) {
+                     keyIndex(element.first).push_back(it);
                      it = next(it);
                  }
                  referenced = false;
@@ -37,27 +79,50 @@ class kvfifo {
              }
         }
 
+        bool full() const noexcept {
+            return size() >= maxSize;
+        }
+
+        // Usuwa element wskazany przez politykę przepełnienia po wstawieniu
+        // elementu pushed. Przy drop_oldest_same_key, gdy pushed nie ma
+        // starszego elementu o tym samym kluczu, działa jak drop_oldest.
+        void evictFor(listIterator pushed) noexcept {
+            if (overflow == kvfifo_overflow::drop_oldest_same_key) {
+                auto key = (*keys).find((*pushed).first);
+                if ((*key).second.front() != pushed) {
+                    (*elements).erase((*key).second.front());
+                    (*key).second.pop_front();
+                    return;
+                }
+            }
+            auto key = (*keys).find((*elements).front().first);
+            (*key).second.pop_front();
+            if ((*key).second.empty())
+                (*keys).erase(key);
+            (*elements).pop_front();
+        }
+
         void tryCopy() {
             if (!elements.unique())
                 makeCopy();
         }
 
-        static std::shared_ptr<std::list<std::pair<K, V>>> emptyElements() {
-            static const auto empty = std::make_shared<std::list<std::pair<K, V>>>();
+        static std::shared_ptr<elementList> emptyElements() {
+            static const auto empty = newElements(Alloc());
             return empty;
         }
 
-        static std::shared_ptr<std::map<K, std::list<listIterator>>> emptyKeys() {
-            static const auto empty = std::make_shared<std::map<K, std::list<listIterator>>>();
+        static std::shared_ptr<keyMap> emptyKeys() {
+            static const auto empty = newKeys(Alloc());
             return empty;
         }
 
     public:
-        class k_iterator : public mapIterator::const_iterator {
+        class k_iterator : public keyMap::const_iterator {
             public:
-                explicit k_iterator(typename mapIterator::const_iterator it) : mapIterator::const_iterator(it) {}
+                explicit k_iterator(typename keyMap::const_iterator it) : keyMap::const_iterator(it) {}
                 K operator*() {
-                    return mapIterator::const_iterator::operator*().first;
+                    return keyMap::const_iterator::operator*().first;
                 }
         };
 
@@ -69,15 +134,103 @@ class kvfifo {
             return k_iterator(keys->cend());
         }
 
-        kvfifo() :
-            elements(std::make_shared<std::list<std::pair<K, V>>>()),
-            keys(std::make_shared<std::map<K, std::list<listIterator>>>()),
+        // Iteratory po parach klucz-wartość w kolejności kolejki. Podobnie jak
+        // k_iterator nie pozwalają modyfikować kolejki, więc nie wymuszają
+        // kopiowania przy zapisie.
+        using const_iterator = typename elementList::const_iterator;
+
+        const_iterator begin() const noexcept {
+            return elements->cbegin();
+        }
+
+        const_iterator end() const noexcept {
+            return elements->cend();
+        }
+
+        const_iterator cbegin() const noexcept {
+            return begin();
+        }
+
+        const_iterator cend() const noexcept {
+            return end();
+        }
+
+        // Iterator po elementach o jednym kluczu, w kolejności kolejki.
+        class key_iterator {
+            private:
+                typename keyList::const_iterator it;
+            public:
+                using iterator_category = std::bidirectional_iterator_tag;
+                using value_type = std::pair<K, V>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = value_type const *;
+                using reference = value_type const &;
+
+                key_iterator() = default;
+
+                explicit key_iterator(typename keyList::const_iterator it) : it(it) {}
+
+                reference operator*() const {
+                    return **it;
+                }
+
+                pointer operator->() const {
+                    return &**it;
+                }
+
+                key_iterator &operator++() {
+                    ++it;
+                    return *this;
+                }
+
+                key_iterator operator++(int) {
+                    key_iterator old = *this;
+                    ++it;
+                    return old;
+                }
+
+                key_iterator &operator--() {
+                    --it;
+                    return *this;
+                }
+
+                key_iterator operator--(int) {
+                    key_iterator old = *this;
+                    --it;
+                    return old;
+                }
+
+                bool operator==(key_iterator const &other) const = default;
+        };
+
+        // Widok na elementy o kluczu k; pusty, gdy klucza nie ma w kolejce.
+        std::ranges::subrange<key_iterator> key_view(K const &k) const {
+            auto key = (*keys).find(k);
+            if (key == (*keys).end())
+                return {key_iterator(), key_iterator()};
+            return {key_iterator((*key).second.cbegin()), key_iterator((*key).second.cend())};
+        }
+
+        kvfifo() : kvfifo(Alloc()) {}
+
+        explicit kvfifo(Alloc const &alloc) :
+            elements(newElements(alloc)),
+            keys(newKeys(alloc)),
             referenced(false) {}
 
+        // Kolejka mieszcząca co najwyżej capacity elementów.
+        explicit kvfifo(size_t capacity, kvfifo_overflow policy = kvfifo_overflow::reject, Alloc const &alloc = Alloc()) :
+            kvfifo(alloc) {
+            maxSize = capacity;
+            overflow = policy;
+        }
+
         kvfifo(kvfifo const &other) :
             elements(other.elements),
             keys(other.keys),
-            referenced(false) {
+            referenced(false),
+            maxSize(other.maxSize),
+            overflow(other.overflow) {
             if (other.referenced)
                 makeCopy();
         }
@@ -85,37 +238,46 @@ class kvfifo {
         kvfifo(kvfifo &&other) noexcept :
                 elements(std::move(other.elements)),
                 keys(std::move(other.keys)),
-                referenced(std::move(other.referenced)) {
+                referenced(std::move(other.referenced)),
+                maxSize(other.maxSize),
+                overflow(other.overflow) {
             other.elements = emptyElements();
             other.keys = emptyKeys();
         }
 
         kvfifo &operator=(kvfifo other) {
-            if (elements == other.elements && keys == other.keys)
-                return *this;
-
-            std::shared_ptr<std::list<std::pair<K, V>>> oldElements = elements;
-            std::shared_ptr<std::map<K, std::list<listIterator>>> oldKeys = keys;
-            try {
-                elements = other.elements;
-                keys = other.keys;
-                referenced = false;
-                if (other.referenced)
-                    makeCopy();
-                return *this;
-            } catch (...) {
-                elements = oldElements;
-                keys = oldKeys;
-                throw;
+            if (elements != other.elements || keys != other.keys) {
+                std::shared_ptr<elementList> oldElements = elements;
+                std::shared_ptr<keyMap> oldKeys = keys;
+                bool oldReferenced = referenced;
+                try {
+                    elements = other.elements;
+                    keys = other.keys;
+                    referenced = false;
+                    if (other.referenced)
+                        makeCopy();
+                } catch (...) {
+                    elements = oldElements;
+                    keys = oldKeys;
+                    referenced = oldReferenced;
+                    throw;
+                }
             }
+            // Limit i polityka przepełnienia zmieniają się dopiero wtedy,
+            // gdy kopiowanie się powiodło.
+            maxSize = other.maxSize;
+            overflow = other.overflow;
+            return *this;
         }
 
         void push(K const &k, V const &v) {
+            if (overflow == kvfifo_overflow::reject && full())
+                throw std::length_error("Queue is full.");
             tryCopy();
             (*elements).push_back({k, v});
             listIterator it = prev((*elements).end());
             try {
-                (*keys)[k].push_back(it);
+                keyIndex(k).push_back(it);
                 referenced = false;
             } catch (...) {
                 (*elements).erase(it);
@@ -123,6 +285,56 @@ class kvfifo {
                     (*keys).erase(k);
                 throw;
             }
+            if (size() > maxSize)
+                evictFor(it);
+        }
+
+        // Jak push, ale przy pełnej kolejce z polityką reject zwraca false.
+        bool try_push(K const &k, V const &v) {
+            if (overflow == kvfifo_overflow::reject && full())
+                return false;
+            push(k, v);
+            return true;
+        }
+
+        // Wstawia na koniec kolejki wszystkie pary z zakresu [first, last).
+        // Kopiowanie przy zapisie wykonywane jest raz dla całego zakresu.
+        template<std::input_iterator It>
+        requires std::constructible_from<std::pair<K, V>, std::iter_reference_t<It>>
+        void push_range(It first, It last) {
+            elementList batch(first, last, allocator());
+            if (batch.empty())
+                return;
+            if (overflow == kvfifo_overflow::reject && batch.size() > maxSize - size())
+                throw std::length_error("Queue is full.");
+            tryCopy();
+            size_t room = maxSize - std::min(size(), maxSize);
+            listIterator it = batch.begin();
+            try {
+                for (; it != batch.end(); it = next(it))
+                    keyIndex((*it).first).push_back(it);
+            } catch (...) {
+                auto failed = (*keys).find((*it).first);
+                if (failed != (*keys).end() && (*failed).second.empty())
+                    (*keys).erase(failed);
+                for (listIterator undo = batch.begin(); undo != it; undo = next(undo)) {
+                    auto key = (*keys).find((*undo).first);
+                    (*key).second.pop_back();
+                    if ((*key).second.empty())
+                        (*keys).erase(key);
+                }
+                throw;
+            }
+            it = batch.begin();
+            (*elements).splice((*elements).end(), batch);
+            referenced = false;
+            for (; room && it != (*elements).end(); room--)
+                it = next(it);
+            while (it != (*elements).end()) {
+                listIterator pushed = it;
+                it = next(it);
+                evictFor(pushed);
+            }
         }
 
         void pop() {
@@ -137,6 +349,24 @@ class kvfifo {
             referenced = false;
         }
 
+        // Usuwa n pierwszych elementów kolejki.
+        void pop_n(size_t n) {
+            if (n > size())
+                throw std::invalid_argument("Invalid operation.");
+            if (!n)
+                return;
+            tryCopy();
+            listIterator last = (*elements).begin();
+            for (size_t i = 0; i < n; i++, last = next(last)) {
+                auto key = (*keys).find((*last).first);
+                (*key).second.pop_front();
+                if ((*key).second.empty())
+                    (*keys).erase(key);
+            }
+            (*elements).erase((*elements).begin(), last);
+            referenced = false;
+        }
+
         void pop(K const &k) {
             if (!count(k))
                 throw std::invalid_argument("Invalid operation.");
@@ -149,6 +379,27 @@ class kvfifo {
             referenced = false;
         }
 
+        // Usuwa z kolejki wszystkie elementy o kluczu k i zwraca ich wartości
+        // w kolejności, w jakiej były w kolejce. Wartości są przenoszone
+        // (o ile przenoszenie nie zgłasza wyjątków), a wektor korzysta
+        // z alokatora kolejki.
+        std::vector<V, rebindAlloc<V>> drain(K const &k) {
+            if (!count(k))
+                throw std::invalid_argument("Invalid operation.");
+            tryCopy();
+            auto key = (*keys).find(k);
+            rebindAlloc<V> valueAlloc(allocator());
+            std::vector<V, rebindAlloc<V>> values(valueAlloc);
+            values.reserve((*key).second.size());
+            for (listIterator it : (*key).second)
+                values.push_back(std::move_if_noexcept((*it).second));
+            for (listIterator it : (*key).second)
+                (*elements).erase(it);
+            (*keys).erase(key);
+            referenced = false;
+            return values;
+        }
+
         void move_to_back(K const &k) {
             size_t size = count(k);
             if (!size)
@@ -227,6 +478,10 @@ class kvfifo {
             return (*elements).empty();
         }
 
+        size_t capacity() const noexcept {
+            return maxSize;
+        }
+
         size_t count(K const &x) const noexcept {
             if (!keys || !(*keys).contains(x))
                 return 0;
@@ -239,4 +494,9 @@ class kvfifo {
             (*keys).clear();
         }
 };
+
+namespace pmr {
+    template<typename K, typename V>
+    using kvfifo = ::kvfifo<K, V, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+}
 #endif
@@ -0,0 +1,251 @@
+// Pomiary wydajności kvfifo: czas, liczba alokacji i szczytowe zużycie pamięci
+// dla podstawowych operacji, dla kolejek od 1e2 do max_size elementów i liczby
+// kluczy 1, sqrt(n) oraz n.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG kvfifo_bench.cc -o kvfifo_bench
+//   ./kvfifo_bench [max_size] > wyniki.json
+//   ./kvfifo_bench [max_size] --baseline kvfifo_bench_baseline.json
+//
+// Z --baseline wyniki są porównywane z zapisanymi. Program kończy się kodem 1,
+// jeśli liczba alokacji na operację lub szczytowa pamięć wzrosła o więcej niż
+// 10%, albo czas na operację wzrósł więcej niż dwukrotnie.
+
+#include "kvfifo.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+    size_t allocations = 0;
+    size_t currentBytes = 0;
+    size_t peakBytes = 0;
+
+    // Rozmiar bloku jest zapisywany przed zwracanym wskaźnikiem.
+    constexpr size_t header = alignof(std::max_align_t);
+
+    void *countedAlloc(size_t size) {
+        void *block = std::malloc(size + header);
+        if (!block)
+            throw std::bad_alloc();
+        *static_cast<size_t *>(block) = size;
+        allocations++;
+        currentBytes += size;
+        peakBytes = std::max(peakBytes, currentBytes);
+        return static_cast<char *>(block) + header;
+    }
+
+    void countedFree(void *ptr) noexcept {
+        if (!ptr)
+            return;
+        void *block = static_cast<char *>(ptr) - header;
+        currentBytes -= *static_cast<size_t *>(block);
+        std::free(block);
+    }
+
+}
+
+void *operator new(size_t size) {
+    return countedAlloc(size);
+}
+
+void *operator new[](size_t size) {
+    return countedAlloc(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+
+namespace {
+
+    using queue = kvfifo<size_t, size_t>;
+
+    struct Result {
+        std::string op;
+        size_t size = 0;
+        size_t keys = 0;
+        double nsPerOp = 0;
+        double allocsPerOp = 0;
+        size_t peakBytes = 0;
+    };
+
+    // Mierzy ops wywołań wykonanych przez body. Szczytowa pamięć obejmuje
+    // również kolejkę przygotowaną przed pomiarem.
+    template<typename Body>
+    Result measure(std::string const &op, size_t size, size_t keys, size_t ops, Body body) {
+        size_t allocationsBefore = allocations;
+        peakBytes = currentBytes;
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto time = std::chrono::steady_clock::now() - start;
+        return {op, size, keys,
+                (double) std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / (double) ops,
+                (double) (allocations - allocationsBefore) / (double) ops,
+                peakBytes};
+    }
+
+    queue filled(size_t size, size_t keys) {
+        queue q;
+        for (size_t i = 0; i < size; i++)
+            q.push(i % keys, i);
+        return q;
+    }
+
+    volatile size_t sink;
+
+    void run(size_t size, size_t keys, std::vector<Result> &results) {
+        {
+            queue q;
+            results.push_back(measure("push", size, keys, size, [&] {
+                for (size_t i = 0; i < size; i++)
+                    q.push(i % keys, i);
+            }));
+        }
+        {
+            queue q = filled(size, keys);
+            results.push_back(measure("pop", size, keys, size, [&] {
+                for (size_t i = 0; i < size; i++)
+                    q.pop();
+            }));
+        }
+        {
+            queue q = filled(size, keys);
+            results.push_back(measure("pop(k)", size, keys, size, [&] {
+                for (size_t i = 0; i < size; i++)
+                    q.pop(i % keys);
+            }));
+        }
+        {
+            // Przeniesienie klucza kosztuje tyle, ile ma on elementów, więc
+            // przenoszonych jest co najwyżej 1000 różnych kluczy.
+            size_t ops = std::min<size_t>(keys, 1000);
+            queue q = filled(size, keys);
+            results.push_back(measure("move_to_back", size, keys, ops, [&] {
+                for (size_t i = 0; i < ops; i++)
+                    q.move_to_back(i);
+            }));
+        }
+        {
+            queue q = filled(size, keys);
+            results.push_back(measure("first", size, keys, size, [&] {
+                for (size_t i = 0; i < size; i++)
+                    sink = q.first(i % keys).second;
+            }));
+            results.push_back(measure("last", size, keys, size, [&] {
+                for (size_t i = 0; i < size; i++)
+                    sink = q.last(i % keys).second;
+            }));
+        }
+        {
+            // Każda kopia współdzieli dane z q, więc pierwsza modyfikacja
+            // kopiuje całą kolejkę.
+            size_t ops = std::max<size_t>(1, 100000 / size);
+            queue q = filled(size, keys);
+            results.push_back(measure("copy-then-modify", size, keys, ops, [&] {
+                for (size_t i = 0; i < ops; i++) {
+                    queue copy = q;
+                    copy.push(0, i);
+                }
+            }));
+        }
+    }
+
+    void print(std::FILE *out, std::vector<Result> const &results) {
+        std::fprintf(out, "[\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            Result const &r = results[i];
+            std::fprintf(out, "{\"op\": \"%s\", \"size\": %zu, \"keys\": %zu, \"ns_per_op\": %.2f, "
+                              "\"allocs_per_op\": %.4f, \"peak_bytes\": %zu}%s\n",
+                         r.op.c_str(), r.size, r.keys, r.nsPerOp, r.allocsPerOp, r.peakBytes,
+                         i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "]\n");
+    }
+
+    // Wczytuje plik w formacie wypisywanym przez print, po jednym wyniku
+    // w wierszu.
+    std::vector<Result> load(char const *path) {
+        std::vector<Result> results;
+        std::ifstream in(path);
+        if (!in)
+            throw std::invalid_argument(std::string("Cannot open ") + path);
+        std::string line;
+        while (std::getline(in, line)) {
+            char op[32];
+            Result r;
+            if (std::sscanf(line.c_str(), "{\"op\": \"%31[^\"]\", \"size\": %zu, \"keys\": %zu, \"ns_per_op\": %lf, "
+                                          "\"allocs_per_op\": %lf, \"peak_bytes\": %zu}",
+                            op, &r.size, &r.keys, &r.nsPerOp, &r.allocsPerOp, &r.peakBytes) == 6) {
+                r.op = op;
+                results.push_back(r);
+            }
+        }
+        return results;
+    }
+
+    bool compare(std::vector<Result> const &results, std::vector<Result> const &baseline) {
+        bool ok = true;
+        for (Result const &r: results) {
+            for (Result const &b: baseline) {
+                if (r.op != b.op || r.size != b.size || r.keys != b.keys)
+                    continue;
+                if (r.allocsPerOp > b.allocsPerOp * 1.1 + 0.01
+                    || (double) r.peakBytes > (double) b.peakBytes * 1.1
+                    || r.nsPerOp > b.nsPerOp * 2 + 1) {
+                    std::fprintf(stderr, "regression: %s size %zu keys %zu: %.2f ns/op (%.2f), "
+                                         "%.4f allocs/op (%.4f), %zu peak bytes (%zu)\n",
+                                 r.op.c_str(), r.size, r.keys, r.nsPerOp, b.nsPerOp,
+                                 r.allocsPerOp, b.allocsPerOp, r.peakBytes, b.peakBytes);
+                    ok = false;
+                }
+            }
+        }
+        return ok;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t maxSize = 10000000;
+    char const *baseline = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--baseline") && i + 1 < argc)
+            baseline = argv[++i];
+        else
+            maxSize = std::strtoull(argv[i], nullptr, 10);
+    }
+
+    std::vector<Result> results;
+    for (size_t size = 100; size <= maxSize; size *= 10) {
+        std::vector<size_t> keyCounts{1, (size_t) std::sqrt((double) size), size};
+        for (size_t keys: keyCounts) {
+            run(size, keys, results);
+            std::fprintf(stderr, "size %zu keys %zu done\n", size, keys);
+        }
+    }
+    print(stdout, results);
+
+    if (baseline)
+        return compare(results, load(baseline)) ? 0 : 1;
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Porównanie wypisywania sakiewek i wartości: dawny operator<< z plural()
+// na std::string, obecny operator<<, std::format_to (jeśli biblioteka ma
+// <format>) oraz Value::to_chars i konwersja do std::string. Dla każdego
+// sposobu podawany jest czas i liczba alokacji na sakiewkę.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG format_bench.cc -o format_bench
+//   ./format_bench [liczba_sakiewek]
+
+#include "moneybag.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <vector>
+
+namespace {
+
+    size_t allocations = 0;
+
+}
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+    // Bufor strumienia, który nadpisuje w kółko tę samą tablicę, żeby
+    // wypisywanie nie alokowało pamięci po stronie strumienia.
+    class DiscardBuffer : public std::streambuf {
+        private:
+            char buffer[4096];
+        protected:
+            int_type overflow(int_type ch) override {
+                setp(buffer, buffer + sizeof(buffer));
+                return traits_type::not_eof(ch);
+            }
+        public:
+            DiscardBuffer() {
+                setp(buffer, buffer + sizeof(buffer));
+            }
+    };
+
+    // Wersja sprzed zmiany: argumenty i wynik jako std::string.
+    const std::string old_plural(const Moneybag::coin_number_t count, const std::string singular, const std::string plural) {
+        if (count == 1) {
+            return singular;
+        }
+        else {
+            return plural;
+        }
+    }
+
+    std::ostream& old_print(std::ostream& stream, const Moneybag &bag) {
+        stream << "(" << bag.livre_number() << " " << old_plural(bag.livre_number(), "livr", "livres") << ", ";
+        stream << bag.solidus_number() << " " << old_plural(bag.solidus_number(), "solidus", "soliduses") << ", ";
+        stream << bag.denier_number() << " " << old_plural(bag.denier_number(), "denier", "deniers") << ")";
+        return stream;
+    }
+
+    template<typename Body>
+    void measure(const char *name, const std::vector<Moneybag> &bags, Body body) {
+        size_t allocationsBefore = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (const Moneybag &bag: bags) {
+            body(bag);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-22s %8.2f ns/bag %8.2f allocs/bag\n", name, ns / (double) bags.size(),
+                    (double) (allocations - allocationsBefore) / (double) bags.size());
+    }
+
+    volatile size_t sink;
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937_64 random(2022);
+    std::uniform_int_distribution<uint64_t> coins(0, 3);
+    std::uniform_int_distribution<uint64_t> large(0, UINT64_MAX);
+    std::vector<Moneybag> bags;
+    bags.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i % 2)
+            bags.emplace_back(coins(random), coins(random), coins(random));
+        else
+            bags.emplace_back(large(random), large(random), large(random));
+    }
+
+    DiscardBuffer buffer;
+    std::ostream stream(&buffer);
+    measure("old operator<<", bags, [&](const Moneybag &bag) {
+        old_print(stream, bag);
+    });
+    measure("operator<<", bags, [&](const Moneybag &bag) {
+        stream << bag;
+    });
+#ifdef __cpp_lib_format
+    measure("std::format_to_n", bags, [&](const Moneybag &bag) {
+        char out[128];
+        sink = (size_t) std::format_to_n(out, sizeof(out), "{}", bag).size;
+    });
+    measure("std::format_to_n Value", bags, [&](const Moneybag &bag) {
+        char out[Value::max_digits];
+        sink = (size_t) std::format_to_n(out, sizeof(out), "{}", Value(bag)).size;
+    });
+#else
+    std::printf("%-22s (brak <format> w bibliotece standardowej)\n", "std::format_to_n");
+#endif
+    measure("Value std::string", bags, [&](const Moneybag &bag) {
+        sink = ((std::string) Value(bag)).size();
+    });
+    measure("Value::to_chars", bags, [&](const Moneybag &bag) {
+        char out[Value::max_digits];
+        sink = (size_t) (Value(bag).to_chars(out) - out);
+    });
+    return 0;
+}
@@ -4,10 +4,32 @@
 #include <cstdint>
 #include <cstdbool>
 #include <string>
+#include <string_view>
+#include <version>
 #include <iostream>
 #include <compare>
 #include <stdexcept>
+#include <vector>
+#include <array>
+#include <map>
+#include <ranges>
+#include <span>
+#include <optional>
+#include <thread>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+#ifdef __cpp_lib_format
+#include <format>
+#endif
+// Tam, gdzie kompilator udostępnia natywny typ 128-bitowy, Value korzysta
+// z niego; boost::multiprecision pozostaje tylko jako zapasowa implementacja.
+#ifdef __SIZEOF_INT128__
+#define MONEYBAG_NATIVE_UINT128
+#else
 #include <boost/multiprecision/cpp_int.hpp>
+#endif
 
 
 class Moneybag {
@@ -102,7 +124,7 @@ class Moneybag {
         }
 };
 
-inline const std::string plural(const Moneybag::coin_number_t count, const std::string singular, const std::string plural) {
+constexpr std::string_view plural(const Moneybag::coin_number_t count, const std::string_view singular, const std::string_view plural) {
     if (count == 1) {
         return singular;
     }
@@ -112,9 +134,9 @@ inline const std::string plural(const Moneybag::coin_number_t count, const std::
 }
 
 inline std::ostream& operator<<(std::ostream& stream, const Moneybag &bag) {
-    stream << "(" << bag.livre_number() << " " << plural(bag.livre_number(), "livr", "livres") << ", ";
-    stream << bag.solidus_number() << " " << plural(bag.solidus_number(), "solidus", "soliduses") << ", ";
-    stream << bag.denier_number() << " " << plural(bag.denier_number(), "denier", "deniers") << ")";
+    stream << '(' << bag.livre_number() << ' ' << plural(bag.livre_number(), "livr", "livres") << ", ";
+    stream << bag.solidus_number() << ' ' << plural(bag.solidus_number(), "solidus", "soliduses") << ", ";
+    stream << bag.denier_number() << ' ' << plural(bag.denier_number(), "denier", "deniers") << ')';
     return stream;
 }
 
@@ -126,23 +148,66 @@ constinit const Moneybag Livre = Moneybag(1, 0, 0);
 constinit const Moneybag Solidus = Moneybag(0, 1, 0);
 constinit const Moneybag Denier = Moneybag(0, 0, 1);
 
+namespace moneybag_literals {
+    consteval Moneybag operator""_l(const unsigned long long livres) {
+        return Moneybag(livres, 0, 0);
+    }
+
+    consteval Moneybag operator""_s(const unsigned long long soliduses) {
+        return Moneybag(0, soliduses, 0);
+    }
+
+    consteval Moneybag operator""_d(const unsigned long long deniers) {
+        return Moneybag(0, 0, deniers);
+    }
+}
+
+// Wymusza obliczenie wyrażenia w czasie kompilowania; przepełnienie
+// jest wtedy błędem kompilacji.
+consteval Moneybag price(const Moneybag bag) {
+    return bag;
+}
+
+// Tablica cen obliczana w czasie kompilowania, np.
+// constexpr auto fees = price_table({3_l + 2_s, 5_d});
+template<size_t N>
+consteval std::array<Moneybag, N> price_table(const Moneybag (&prices)[N]) {
+    return std::to_array(prices);
+}
+
 class Value {
+    public:
+#ifdef MONEYBAG_NATIVE_UINT128
+        __extension__ typedef unsigned __int128 value_t;
+#else
+        using value_t = boost::multiprecision::uint128_t;
+#endif
     private:
-        boost::multiprecision::uint128_t value;
+        value_t value;
     public:
         constexpr Value() : value(0) {}
 
         constexpr Value(const uint64_t val) : value(val) {}
 
-        static constexpr boost::multiprecision::uint128_t sum(const Moneybag& bag) {
-            boost::multiprecision::uint128_t sum = bag.denier_number();
-            sum += 12 * (boost::multiprecision::uint128_t)bag.solidus_number();
-            sum += 240 * (boost::multiprecision::uint128_t)bag.livre_number();
+        static constexpr value_t sum(const Moneybag& bag) {
+            value_t sum = bag.denier_number();
+            sum += 12 * (value_t)bag.solidus_number();
+            sum += 240 * (value_t)bag.livre_number();
             return sum;
         }
 
         constexpr Value(const Moneybag& bag) : value(sum(bag)) {}
 
+        static constexpr Value from_deniers(const value_t deniers) {
+            Value result;
+            result.value = deniers;
+            return result;
+        }
+
+        constexpr value_t deniers() const {
+            return value;
+        }
+
         constexpr Value(const Value &val) = default;
 
         constexpr std::strong_ordering operator<=>(const uint64_t number) const{
@@ -177,8 +242,453 @@ class Value {
             return value == other.value;
         }
 
+        // Maksymalna liczba cyfr dziesiętnych wartości.
+        static constexpr size_t max_digits = 39;
+
+#ifdef MONEYBAG_NATIVE_UINT128
+        // Zapisuje cyfry wartości od first (co najmniej max_digits znaków)
+        // i zwraca koniec zapisu. Dzieli wartość na kawałki po 19 cyfr, żeby
+        // większość dzieleń wykonywać na 64 bitach.
+        constexpr char *to_chars(char *first) const {
+            constexpr uint64_t chunk = 10000000000000000000ULL;
+            char buffer[max_digits] = {};
+            char *end = buffer + max_digits;
+            char *it = end;
+            value_t rest = value;
+            while (rest > UINT64_MAX) {
+                uint64_t low = (uint64_t)(rest % chunk);
+                rest /= chunk;
+                for (int i = 0; i < 19; i++) {
+                    *--it = (char)('0' + low % 10);
+                    low /= 10;
+                }
+            }
+            uint64_t high = (uint64_t)rest;
+            do {
+                *--it = (char)('0' + high % 10);
+                high /= 10;
+            } while (high);
+            return std::copy(it, end, first);
+        }
+
+        constexpr explicit operator std::string() const {
+            char buffer[max_digits] = {};
+            return std::string(buffer, to_chars(buffer));
+        }
+#else
+        char *to_chars(char *first) const {
+            const std::string digits = value.str();
+            return std::copy(digits.begin(), digits.end(), first);
+        }
+
         explicit operator std::string() const {
             return value.str();
         }
+#endif
+};
+
+// Tablica sakiewek w układzie kolumnowym (osobno liwry, solidy i denary).
+// Operacje wsadowe sprawdzają przepełnienie raz dla całej tablicy, bez
+// rozgałęzień na każdy element, i podobnie jak operatory Moneybag nie zmieniają
+// zawartości, jeśli zgłaszają wyjątek.
+class MoneybagArray {
+    public:
+        using coin_number_t = Moneybag::coin_number_t;
+    private:
+        std::vector<coin_number_t> livres;
+        std::vector<coin_number_t> soliduses;
+        std::vector<coin_number_t> deniers;
+
+        // Młodsze i starsze 32 bity monet są sumowane osobno, więc w pętli
+        // nie ma sprawdzania przepełnienia po każdym dodawaniu i kompilator
+        // może ją zwektoryzować. Paczka ma mniej niż 2^32 monet, żeby żadna
+        // z sum połówek się nie przepełniła.
+        static coin_number_t total(const std::vector<coin_number_t> &coins, bool &overflow) {
+            constexpr size_t chunk = UINT32_MAX;
+            const coin_number_t *data = coins.data();
+            const size_t n = coins.size();
+            coin_number_t low = 0, high = 0;
+            for (size_t begin = 0; begin < n; begin += std::min(n - begin, chunk)) {
+                const size_t end = begin + std::min(n - begin, chunk);
+                coin_number_t chunkLow = 0, chunkHigh = 0;
+                for (size_t i = begin; i < end; i++) {
+                    chunkLow += data[i] & UINT32_MAX;
+                    chunkHigh += data[i] >> 32;
+                }
+                low += chunkLow;
+                high += chunkHigh + (low >> 32);
+                low &= UINT32_MAX;
+                if (high > UINT32_MAX) {
+                    overflow = true;
+                    break;
+                }
+            }
+            return (high << 32) | low;
+        }
+
+
+        // 1, jeśli któraś z monet jest większa od limit.
+        // Dodaje b do a i zwraca 1, jeśli któraś z sum się przepełniła.
+        static coin_number_t add(coin_number_t *a, const coin_number_t *b, const size_t n) {
+            coin_number_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                coin_number_t sum = a[i] + b[i];
+                carry |= sum < b[i];
+                a[i] = sum;
+            }
+            return carry;
+        }
+
+        static void subtract(coin_number_t *a, const coin_number_t *b, const size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                a[i] -= b[i];
+            }
+        }
+
+        static void multiply(coin_number_t *coins, const size_t n, const uint64_t lambda) {
+            for (size_t i = 0; i < n; i++) {
+                coins[i] *= lambda;
+            }
+        }
+
+        static coin_number_t above(const coin_number_t *coins, const size_t n, const coin_number_t limit) {
+            coin_number_t result = 0;
+            for (size_t i = 0; i < n; i++) {
+                result |= coins[i] > limit;
+            }
+            return result;
+        }
+
+    public:
+        MoneybagArray() = default;
+
+        explicit MoneybagArray(std::span<const Moneybag> bags) {
+            reserve(bags.size());
+            for (const Moneybag &bag : bags) {
+                push_back(bag);
+            }
+        }
+
+        size_t size() const {
+            return livres.size();
+        }
+
+        void reserve(size_t n) {
+            livres.reserve(n);
+            soliduses.reserve(n);
+            deniers.reserve(n);
+        }
+
+        void push_back(const Moneybag &bag) {
+            livres.push_back(bag.livre_number());
+            soliduses.push_back(bag.solidus_number());
+            deniers.push_back(bag.denier_number());
+        }
+
+        Moneybag operator[](size_t i) const {
+            return Moneybag(livres[i], soliduses[i], deniers[i]);
+        }
+
+        // Suma wszystkich sakiewek, jak złożenie operator+ po kolei.
+        Moneybag sum() const {
+            bool overflow = false;
+            Moneybag result(total(livres, overflow), total(soliduses, overflow), total(deniers, overflow));
+            if (overflow) {
+                throw std::out_of_range("Overflow during addition");
+            }
+            return result;
+        }
+
+        // Dodaje do każdej sakiewki odpowiadającą jej sakiewkę z other.
+        MoneybagArray& operator+=(const MoneybagArray &other) {
+            if (size() != other.size()) {
+                throw std::invalid_argument("Arrays of different sizes");
+            }
+            if (this == &other) {
+                return *this += MoneybagArray(other);
+            }
+            // Dodawanie odbywa się w jednym przejściu; przy przepełnieniu
+            // sumy są cofane odejmowaniem, które w arytmetyce modulo 2^64
+            // przywraca dokładnie poprzednie wartości.
+            const size_t n = size();
+            if (add(livres.data(), other.livres.data(), n) | add(soliduses.data(), other.soliduses.data(), n)
+                | add(deniers.data(), other.deniers.data(), n)) {
+                subtract(livres.data(), other.livres.data(), n);
+                subtract(soliduses.data(), other.soliduses.data(), n);
+                subtract(deniers.data(), other.deniers.data(), n);
+                throw std::out_of_range("Overflow during addition");
+            }
+            return *this;
+        }
+
+        // Mnoży każdą sakiewkę przez lambda.
+        MoneybagArray& scale(const uint64_t lambda) {
+            const coin_number_t limit = lambda ? UINT64_MAX / lambda : UINT64_MAX;
+            const size_t n = size();
+            if (above(livres.data(), n, limit) | above(soliduses.data(), n, limit) | above(deniers.data(), n, limit)) {
+                throw std::out_of_range("Overflow during multiplication");
+            }
+            multiply(livres.data(), n, lambda);
+            multiply(soliduses.data(), n, lambda);
+            multiply(deniers.data(), n, lambda);
+            return *this;
+        }
+
+        std::vector<Value> to_value() const {
+            const size_t n = size();
+            std::vector<Value> values(n);
+            for (size_t i = 0; i < n; i++) {
+                values[i] = Value::from_deniers(deniers[i] + 12 * (Value::value_t) soliduses[i]
+                                                + 240 * (Value::value_t) livres[i]);
+            }
+            return values;
+        }
+
+        // Porównuje sakiewki parami, tak jak Moneybag::operator<=>.
+        std::vector<std::partial_ordering> compare(const MoneybagArray &other) const {
+            if (size() != other.size()) {
+                throw std::invalid_argument("Arrays of different sizes");
+            }
+            // Wynik jest zapisywany bajtami reprezentacji std::partial_ordering;
+            // wybór spośród czterech stałych, zamiast odczytu z tablicy,
+            // pozwala zwektoryzować pętlę.
+            static_assert(std::is_trivially_copyable_v<std::partial_ordering> && sizeof(std::partial_ordering) == 1);
+            constexpr std::byte unordered = std::bit_cast<std::byte>(std::partial_ordering::unordered);
+            constexpr std::byte less = std::bit_cast<std::byte>(std::partial_ordering::less);
+            constexpr std::byte greater = std::bit_cast<std::byte>(std::partial_ordering::greater);
+            constexpr std::byte equivalent = std::bit_cast<std::byte>(std::partial_ordering::equivalent);
+            const size_t n = size();
+            std::vector<std::partial_ordering> result(n, std::partial_ordering::unordered);
+            std::byte *out = reinterpret_cast<std::byte *>(result.data());
+            for (size_t i = 0; i < n; i++) {
+                bool le = (livres[i] <= other.livres[i]) & (soliduses[i] <= other.soliduses[i]) & (deniers[i] <= other.deniers[i]);
+                bool ge = (livres[i] >= other.livres[i]) & (soliduses[i] >= other.soliduses[i]) & (deniers[i] >= other.deniers[i]);
+                out[i] = le ? (ge ? equivalent : less) : (ge ? greater : unordered);
+            }
+            return result;
+        }
+};
+
+// Wynik sumowania wielu sakiewek: dokładne sumy poszczególnych monet, łączna
+// wartość oraz indeks pierwszej sakiewki, której dodanie przy sumowaniu po kolei
+// operatorem + zgłosiłoby przepełnienie.
+struct MoneybagTotal {
+    Value::value_t livres = 0;
+    Value::value_t soliduses = 0;
+    Value::value_t deniers = 0;
+    Value value;
+    std::optional<size_t> overflow_index;
+};
+
+// Sumuje sakiewki równolegle na wszystkich rdzeniach.
+inline MoneybagTotal parallel_sum(std::span<const Moneybag> bags,
+                                  unsigned threads = std::thread::hardware_concurrency()) {
+    constexpr size_t min_chunk = 1 << 16;
+    threads = (unsigned)std::clamp<size_t>(bags.size() / min_chunk, 1, std::max(threads, 1u));
+    const size_t chunk = (bags.size() + threads - 1) / threads;
+
+    std::vector<MoneybagTotal> partial(threads);
+    auto sum_chunk = [&](unsigned t) {
+        MoneybagTotal &total = partial[t];
+        for (size_t i = t * chunk; i < std::min(bags.size(), (t + 1) * chunk); i++) {
+            total.livres += bags[i].livre_number();
+            total.soliduses += bags[i].solidus_number();
+            total.deniers += bags[i].denier_number();
+        }
+    };
+    std::vector<std::jthread> workers;
+    for (unsigned t = 1; t < threads; t++) {
+        workers.emplace_back(sum_chunk, t);
+    }
+    sum_chunk(0);
+    workers.clear();
+
+    MoneybagTotal result;
+    for (unsigned t = 0; t < threads; t++) {
+        const MoneybagTotal &total = partial[t];
+        if (!result.overflow_index && (result.livres + total.livres > UINT64_MAX
+                || result.soliduses + total.soliduses > UINT64_MAX
+                || result.deniers + total.deniers > UINT64_MAX)) {
+            Value::value_t livres = result.livres, soliduses = result.soliduses, deniers = result.deniers;
+            for (size_t i = t * chunk; !result.overflow_index; i++) {
+                livres += bags[i].livre_number();
+                soliduses += bags[i].solidus_number();
+                deniers += bags[i].denier_number();
+                if (livres > UINT64_MAX || soliduses > UINT64_MAX || deniers > UINT64_MAX) {
+                    result.overflow_index = i;
+                }
+            }
+        }
+        result.livres += total.livres;
+        result.soliduses += total.soliduses;
+        result.deniers += total.deniers;
+    }
+    result.value = Value::from_deniers(result.deniers + 12 * result.soliduses + 240 * result.livres);
+    return result;
+}
+
+// Kolekcja sakiewek uporządkowana według ich wartości. Wartość każdej
+// sakiewki jest liczona raz, przy wstawianiu.
+class MoneybagIndex {
+    private:
+        using index_t = std::multimap<Value, Moneybag>;
+        index_t bags;
+    public:
+        using const_iterator = index_t::const_iterator;
+        using range_t = std::ranges::subrange<const_iterator>;
+
+        const_iterator insert(const Moneybag &bag) {
+            return bags.emplace(Value(bag), bag);
+        }
+
+        const_iterator erase(const_iterator it) {
+            return bags.erase(it);
+        }
+
+        size_t size() const {
+            return bags.size();
+        }
+
+        const_iterator begin() const {
+            return bags.cbegin();
+        }
+
+        const_iterator end() const {
+            return bags.cend();
+        }
+
+        // Sakiewki o wartości z przedziału [low, high].
+        range_t between(const Value &low, const Value &high) const {
+            if (high < low) {
+                return {bags.cend(), bags.cend()};
+            }
+            return {bags.lower_bound(low), bags.upper_bound(high)};
+        }
+
+        // k sakiewek o największej wartości, od największej.
+        std::vector<Moneybag> top(size_t k) const {
+            std::vector<Moneybag> result;
+            result.reserve(std::min(k, size()));
+            for (auto it = bags.crbegin(); it != bags.crend() && result.size() < k; ++it) {
+                result.push_back(it->second);
+            }
+            return result;
+        }
 };
+
+// Binarny format sakiewek i wartości: liczby 64-bitowe w porządku little-endian,
+// sakiewka jako (liwry, solidy, denary), wartość jako (młodsze, starsze 64 bity).
+// Na maszynach little-endian format sakiewek pokrywa się z ich reprezentacją
+// w pamięci, więc kodowanie tablicy to jedno kopiowanie bajtów.
+namespace wire {
+    constexpr size_t moneybag_size = 3 * sizeof(uint64_t);
+    constexpr size_t value_size = 2 * sizeof(uint64_t);
+
+    static_assert(std::is_trivially_copyable_v<Moneybag> && sizeof(Moneybag) == moneybag_size);
+
+    constexpr uint64_t little_endian(uint64_t x) {
+        if constexpr (std::endian::native == std::endian::little) {
+            return x;
+        }
+        uint64_t result = 0;
+        for (size_t i = 0; i < sizeof(x); i++, x >>= 8) {
+            result = (result << 8) | (x & 0xff);
+        }
+        return result;
+    }
+
+    inline void store(std::byte *out, uint64_t x) {
+        x = little_endian(x);
+        std::memcpy(out, &x, sizeof(x));
+    }
+
+    inline uint64_t load(const std::byte *in) {
+        uint64_t x;
+        std::memcpy(&x, in, sizeof(x));
+        return little_endian(x);
+    }
+
+    // Zwraca zapisaną część bufora out.
+    inline std::span<std::byte> encode(std::span<const Moneybag> bags, std::span<std::byte> out) {
+        if (out.size() / moneybag_size < bags.size()) {
+            throw std::out_of_range("Buffer too small");
+        }
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(out.data(), bags.data(), bags.size_bytes());
+        }
+        else {
+            for (size_t i = 0; i < bags.size(); i++) {
+                store(&out[i * moneybag_size], bags[i].livre_number());
+                store(&out[i * moneybag_size + 8], bags[i].solidus_number());
+                store(&out[i * moneybag_size + 16], bags[i].denier_number());
+            }
+        }
+        return out.first(bags.size() * moneybag_size);
+    }
+
+    inline std::vector<Moneybag> decode_moneybags(std::span<const std::byte> in) {
+        if (in.size() % moneybag_size) {
+            throw std::invalid_argument("Truncated moneybag data");
+        }
+        std::vector<Moneybag> bags;
+        bags.reserve(in.size() / moneybag_size);
+        for (size_t i = 0; i < in.size(); i += moneybag_size) {
+            bags.push_back(Moneybag(load(&in[i]), load(&in[i + 8]), load(&in[i + 16])));
+        }
+        return bags;
+    }
+
+    inline std::span<std::byte> encode(std::span<const Value> values, std::span<std::byte> out) {
+        if (out.size() / value_size < values.size()) {
+            throw std::out_of_range("Buffer too small");
+        }
+        for (size_t i = 0; i < values.size(); i++) {
+            store(&out[i * value_size], (uint64_t)values[i].deniers());
+            store(&out[i * value_size + 8], (uint64_t)(values[i].deniers() >> 64));
+        }
+        return out.first(values.size() * value_size);
+    }
+
+    inline std::vector<Value> decode_values(std::span<const std::byte> in) {
+        if (in.size() % value_size) {
+            throw std::invalid_argument("Truncated value data");
+        }
+        std::vector<Value> values;
+        values.reserve(in.size() / value_size);
+        for (size_t i = 0; i < in.size(); i += value_size) {
+            Value::value_t deniers = load(&in[i + 8]);
+            deniers = (deniers << 64) | load(&in[i]);
+            values.push_back(Value::from_deniers(deniers));
+        }
+        return values;
+    }
+}
+
+#ifdef __cpp_lib_format
+template<>
+struct std::formatter<Moneybag> {
+    constexpr auto parse(std::format_parse_context &ctx) {
+        return ctx.begin();
+    }
+
+    auto format(const Moneybag &bag, std::format_context &ctx) const {
+        return std::format_to(ctx.out(), "({} {}, {} {}, {} {})",
+                              bag.livre_number(), plural(bag.livre_number(), "livr", "livres"),
+                              bag.solidus_number(), plural(bag.solidus_number(), "solidus", "soliduses"),
+                              bag.denier_number(), plural(bag.denier_number(), "denier", "deniers"));
+    }
+};
+
+template<>
+struct std::formatter<Value> {
+    constexpr auto parse(std::format_parse_context &ctx) {
+        return ctx.begin();
+    }
+
+    auto format(const Value &value, std::format_context &ctx) const {
+        char buffer[Value::max_digits];
+        return std::copy(buffer, value.to_chars(buffer), ctx.out());
+    }
+};
+#endif
 #endif
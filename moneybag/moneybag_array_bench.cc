@@ -0,0 +1,136 @@
+// Porównanie operacji na całej MoneybagArray z tymi samymi operacjami
+// wykonywanymi po kolei na std::vector<Moneybag>. Pętle MoneybagArray są
+// wektoryzowane dopiero od -O3 (g++ 12 przy -O2 ich nie wektoryzuje).
+//
+//   g++ -std=c++20 -O3 -march=native -DNDEBUG moneybag_array_bench.cc -o moneybag_array_bench
+//   ./moneybag_array_bench [liczba_sakiewek] [liczba_powtórzeń]
+
+#include "moneybag.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    template<typename Body>
+    double nanoseconds(unsigned repeats, Body body) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned r = 0; r < repeats; r++) {
+            body();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repeats;
+    }
+
+    void report(const char *name, size_t count, double scalarNs, double batchNs, bool equal) {
+        std::printf("%-10s scalar %7.3f ns/bag  batch %7.3f ns/bag  speedup %5.2fx  %s\n", name,
+                    scalarNs / (double) count, batchNs / (double) count, scalarNs / batchNs,
+                    equal ? "identical" : "DIFFERENT");
+    }
+
+    // Mnożnik odczytywany w czasie działania, żeby kompilator nie usunął
+    // mnożenia przez 1.
+    volatile uint64_t identity = 1;
+
+    bool same(const std::vector<Moneybag> &bags, const MoneybagArray &array) {
+        for (size_t i = 0; i < bags.size(); i++) {
+            if (!(bags[i] == array[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    unsigned repeats = argc > 2 ? (unsigned) std::strtoul(argv[2], nullptr, 10) : 200;
+
+    std::mt19937_64 random(2022);
+    std::uniform_int_distribution<uint64_t> coins(0, 1000);
+    std::vector<Moneybag> first, second;
+    first.reserve(count);
+    second.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        first.emplace_back(coins(random), coins(random), coins(random));
+        second.emplace_back(coins(random), coins(random), coins(random));
+    }
+    const MoneybagArray firstArray(first), secondArray(second);
+    std::printf("bags %zu repeats %u\n", count, repeats);
+    bool ok = true;
+
+    Moneybag scalarSum(0, 0, 0), batchSum(0, 0, 0);
+    double scalarNs = nanoseconds(repeats, [&] {
+        scalarSum = Moneybag(0, 0, 0);
+        for (const Moneybag &bag: first) {
+            scalarSum += bag;
+        }
+    });
+    double batchNs = nanoseconds(repeats, [&] {
+        batchSum = firstArray.sum();
+    });
+    report("sum", count, scalarNs, batchNs, scalarSum == batchSum);
+    ok &= scalarSum == batchSum;
+
+    // Powtórzenia działają na tych samych sakiewkach; przy monetach do 1000
+    // i kilkuset powtórzeniach wartości nie zbliżają się do przepełnienia.
+    std::vector<Moneybag> scalarBags = first;
+    MoneybagArray batchBags = firstArray;
+    scalarNs = nanoseconds(repeats, [&] {
+        for (size_t i = 0; i < count; i++) {
+            scalarBags[i] += second[i];
+        }
+    });
+    batchNs = nanoseconds(repeats, [&] {
+        batchBags += secondArray;
+    });
+    report("+=", count, scalarNs, batchNs, same(scalarBags, batchBags));
+    ok &= same(scalarBags, batchBags);
+
+    const uint64_t lambda = identity;
+    scalarNs = nanoseconds(repeats, [&] {
+        for (Moneybag &bag: scalarBags) {
+            bag *= lambda;
+        }
+    });
+    batchNs = nanoseconds(repeats, [&] {
+        batchBags.scale(lambda);
+    });
+    report("scale", count, scalarNs, batchNs, same(scalarBags, batchBags));
+    ok &= same(scalarBags, batchBags);
+
+    std::vector<Value> scalarValues, batchValues;
+    scalarNs = nanoseconds(repeats, [&] {
+        std::vector<Value> values;
+        values.reserve(count);
+        for (const Moneybag &bag: first) {
+            values.push_back(Value(bag));
+        }
+        scalarValues = std::move(values);
+    });
+    batchNs = nanoseconds(repeats, [&] {
+        batchValues = firstArray.to_value();
+    });
+    report("to_value", count, scalarNs, batchNs, scalarValues == batchValues);
+    ok &= scalarValues == batchValues;
+
+    std::vector<std::partial_ordering> scalarOrder, batchOrder;
+    scalarNs = nanoseconds(repeats, [&] {
+        std::vector<std::partial_ordering> order;
+        order.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            order.push_back(first[i] <=> second[i]);
+        }
+        scalarOrder = std::move(order);
+    });
+    batchNs = nanoseconds(repeats, [&] {
+        batchOrder = firstArray.compare(secondArray);
+    });
+    report("compare", count, scalarNs, batchNs, scalarOrder == batchOrder);
+    ok &= scalarOrder == batchOrder;
+
+    return ok ? 0 : 1;
+}
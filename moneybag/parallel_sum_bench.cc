@@ -0,0 +1,57 @@
+// Porównanie parallel_sum z sumowaniem po kolei przez std::accumulate
+// i operator+ Moneybag.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -pthread parallel_sum_bench.cc -o parallel_sum_bench
+//   ./parallel_sum_bench [liczba_sakiewek] [liczba_wątków]
+
+#include "moneybag.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+    template<typename Body>
+    double milliseconds(Body body) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    unsigned threads = argc > 2 ? (unsigned) std::strtoul(argv[2], nullptr, 10)
+                                : std::thread::hardware_concurrency();
+
+    std::mt19937_64 random(2022);
+    std::uniform_int_distribution<uint64_t> coins(0, 1000);
+    std::vector<Moneybag> bags;
+    bags.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        bags.emplace_back(coins(random), coins(random), coins(random));
+    }
+
+    Moneybag serial(0, 0, 0);
+    double serialTime = milliseconds([&] {
+        serial = std::accumulate(bags.begin(), bags.end(), Moneybag(0, 0, 0));
+    });
+    MoneybagTotal parallel;
+    double parallelTime = milliseconds([&] {
+        parallel = parallel_sum(bags, threads);
+    });
+
+    bool same = parallel.livres == serial.livre_number() && parallel.soliduses == serial.solidus_number()
+                && parallel.deniers == serial.denier_number() && parallel.value == Value(serial)
+                && !parallel.overflow_index;
+    std::printf("bags %zu threads %u\n", count, threads);
+    std::printf("std::accumulate %10.2f ms %8.2f ns/bag\n", serialTime, serialTime * 1e6 / (double) count);
+    std::printf("parallel_sum    %10.2f ms %8.2f ns/bag\n", parallelTime, parallelTime * 1e6 / (double) count);
+    std::printf("speedup %.2fx, totals %s\n", serialTime / parallelTime, same ? "equal" : "DIFFERENT");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// Pomiar czasu kompilacji i rozmiaru kodu wynikowego encounter dla N różnych
+// typów gatunków. Dla każdego typu tworzone są wszystkie dozwolone pary diet
+// (15 wersji encounter i odpowiadające im eats).
+//
+//   g++ -std=c++20 -O2 compile_bench.cc -o compile_bench
+//   ./compile_bench [--header ścieżka/organism.h] [--source compile_bench.cc]
+//
+// Program kompiluje ten plik z -DSPECIES_COUNT=N dla kilku N (kompilatorem
+// z $CXX, domyślnie g++) i wypisuje czas kompilacji oraz rozmiar pliku .o.
+// Opcja --header pozwala zmierzyć inną wersję organism.h.
+
+#ifdef SPECIES_COUNT
+
+#ifdef ORGANISM_HEADER
+#include ORGANISM_HEADER
+#else
+#include "organism.h"
+#endif
+
+#include <utility>
+
+template<size_t I>
+struct Species {
+    int id;
+
+    bool operator==(Species const &) const = default;
+};
+
+template<typename S, bool m1, bool p1, bool m2, bool p2>
+uint64_t meet(uint64_t vitality) {
+    if constexpr (!m1 && !p1 && !m2 && !p2) {
+        return 0;
+    } else {
+        auto [organism1, organism2, child] = encounter(Organism<S, m1, p1>(S{1}, vitality),
+                                                       Organism<S, m2, p2>(S{(int)(vitality & 1)}, vitality / 2 + 1));
+        return organism1.get_vitality() + organism2.get_vitality() + child.has_value();
+    }
+}
+
+// Wszystkie pary diet; kolejne bity numeru to m1, p1, m2, p2.
+template<typename S, size_t... Diets>
+uint64_t all_diets(uint64_t vitality, std::index_sequence<Diets...>) {
+    return (meet<S, bool(Diets & 1), bool(Diets & 2), bool(Diets & 4), bool(Diets & 8)>(vitality) + ...);
+}
+
+template<size_t... I>
+uint64_t all_species(uint64_t vitality, std::index_sequence<I...>) {
+    return (all_diets<Species<I>>(vitality, std::make_index_sequence<16>()) + ...);
+}
+
+uint64_t run(uint64_t vitality) {
+    return all_species(vitality, std::make_index_sequence<SPECIES_COUNT>());
+}
+
+#else
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+int main(int argc, char *argv[]) {
+    std::string source = __FILE__;
+    std::string header;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--header"))
+            header = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--source"))
+            source = argv[i + 1];
+    }
+    const char *compiler = std::getenv("CXX") ? std::getenv("CXX") : "g++";
+    std::filesystem::path object = std::filesystem::temp_directory_path() / "organism_compile_bench.o";
+
+    std::printf("%8s %12s %12s %14s\n", "species", "time [ms]", "object [B]", "B/species");
+    for (int species: {1, 4, 16, 64}) {
+        std::string command = std::string(compiler) + " -std=c++20 -O2 -c -DSPECIES_COUNT=" + std::to_string(species);
+        if (!header.empty())
+            command += " '-DORGANISM_HEADER=\"" + header + "\"'";
+        command += " '" + source + "' -o '" + object.string() + "'";
+        auto start = std::chrono::steady_clock::now();
+        if (std::system(command.c_str()) != 0) {
+            std::fprintf(stderr, "compilation failed: %s\n", command.c_str());
+            return 1;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        auto size = std::filesystem::file_size(object);
+        std::printf("%8d %12.0f %12ju %14.0f\n", species, ms, (uintmax_t) size, (double) size / species);
+    }
+    std::filesystem::remove(object);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,135 @@
+// Porównanie encounter_kernel ze skalarnym encounter na tych samych
+// losowych parach organizmów. Pary o jednym układzie diet są rozstrzygane
+// przez encounter bezpośrednio, a pary o mieszanych dietach przez std::visit
+// na AnyOrganism. Wyniki obu wersji muszą być identyczne.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -pthread encounter_bench.cc -o encounter_bench
+//   ./encounter_bench [liczba_par]
+
+#include "organism_population.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using species_t = uint32_t;
+
+    template<typename Body>
+    double nanoseconds(Body body) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    AnyOrganism<species_t> make(Diet diet, species_t species, uint64_t vitality) {
+        switch (diet) {
+            case Diet::carnivore:
+                return Carnivore<species_t>(species, vitality);
+            case Diet::omnivore:
+                return Omnivore<species_t>(species, vitality);
+            case Diet::herbivore:
+                return Herbivore<species_t>(species, vitality);
+            default:
+                return Plant<species_t>(species, vitality);
+        }
+    }
+
+    // Rozstrzyga spotkanie skalarnie i zapisuje wynik w kolumnach batch
+    // na pozycji i, w tej samej postaci co encounter_kernel.
+    template<typename O1, typename O2>
+    void scalar(O1 organism1, O2 organism2, EncounterBatch &batch, size_t i) {
+        auto [result1, result2, child] = encounter(organism1, organism2);
+        batch.vitality1[i] = result1.get_vitality();
+        batch.vitality2[i] = result2.get_vitality();
+        batch.mated[i] = child.has_value();
+    }
+
+    bool same(EncounterBatch const &a, EncounterBatch const &b) {
+        return a.vitality1 == b.vitality1 && a.vitality2 == b.vitality2 && a.mated == b.mated;
+    }
+
+    void report(const char *name, size_t count, double scalarNs, double kernelNs, bool equal) {
+        std::printf("%-22s scalar %7.2f ns/pair  kernel %7.2f ns/pair  speedup %5.2fx  %s\n", name,
+                    scalarNs / (double) count, kernelNs / (double) count, scalarNs / kernelNs,
+                    equal ? "identical" : "DIFFERENT");
+    }
+
+    // Wszystkie pary mają diety d1 i d2, znane w czasie kompilacji.
+    template<bool m1, bool p1, bool m2, bool p2>
+    bool fixed(const char *name, EncounterBatch const &input) {
+        std::vector<Organism<species_t, m1, p1>> first;
+        std::vector<Organism<species_t, m2, p2>> second;
+        for (size_t i = 0; i < input.size(); i++) {
+            first.emplace_back(input.species1[i], input.vitality1[i]);
+            second.emplace_back(input.species2[i], input.vitality2[i]);
+        }
+        EncounterBatch expected = input;
+        expected.mated.resize(input.size());
+        double scalarNs = nanoseconds([&] {
+            for (size_t i = 0; i < input.size(); i++)
+                scalar(first[i], second[i], expected, i);
+        });
+        EncounterBatch batch = input;
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch.diet1[i] = diet_of(m1, p1);
+            batch.diet2[i] = diet_of(m2, p2);
+        }
+        double kernelNs = nanoseconds([&] {
+            encounter_kernel(batch);
+        });
+        bool equal = same(expected, batch);
+        report(name, input.size(), scalarNs, kernelNs, equal);
+        return equal;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+
+    std::mt19937_64 random(2022);
+    std::uniform_int_distribution<int> diet(0, 3);
+    std::uniform_int_distribution<species_t> species(0, 3);
+    std::uniform_int_distribution<uint64_t> vitality(0, 1000);
+    EncounterBatch input;
+    while (input.size() < count) {
+        Diet d1 = Diet(diet(random)), d2 = Diet(diet(random));
+        if (d1 == Diet::plant && d2 == Diet::plant)
+            continue;
+        input.push_back(d1, species(random), vitality(random), d2, species(random), vitality(random));
+    }
+
+    bool ok = true;
+    ok &= fixed<true, false, true, false>("carnivore-carnivore", input);
+    ok &= fixed<true, false, false, true>("carnivore-herbivore", input);
+    ok &= fixed<true, true, false, false>("omnivore-plant", input);
+    ok &= fixed<false, true, true, true>("herbivore-omnivore", input);
+
+    std::vector<AnyOrganism<species_t>> first, second;
+    for (size_t i = 0; i < input.size(); i++) {
+        first.push_back(make(input.diet1[i], input.species1[i], input.vitality1[i]));
+        second.push_back(make(input.diet2[i], input.species2[i], input.vitality2[i]));
+    }
+    EncounterBatch expected = input;
+    expected.mated.resize(input.size());
+    double scalarNs = nanoseconds([&] {
+        for (size_t i = 0; i < input.size(); i++) {
+            std::visit([&]<typename O1, typename O2>(O1 const &organism1, O2 const &organism2) {
+                if constexpr (!(O1(0, 0).is_plant() && O2(0, 0).is_plant()))
+                    scalar(organism1, organism2, expected, i);
+            }, first[i], second[i]);
+        }
+    });
+    EncounterBatch batch = input;
+    double kernelNs = nanoseconds([&] {
+        encounter_kernel(batch);
+    });
+    bool equal = same(expected, batch);
+    report("mixed (std::visit)", input.size(), scalarNs, kernelNs, equal);
+    ok &= equal;
+    return ok ? 0 : 1;
+}
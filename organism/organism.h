@@ -6,6 +6,70 @@
 #include <optional>
 #include <numeric>
 #include <tuple>
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <variant>
+#include <iterator>
+#include <ranges>
+
+// Rodzaj organizmu znany dopiero w czasie wykonania.
+enum class Diet : uint8_t {
+    plant = 0,
+    herbivore = 1,
+    carnivore = 2,
+    omnivore = 3
+};
+
+constexpr Diet diet_of(bool can_eat_meat, bool can_eat_plants) {
+    return Diet(2 * can_eat_meat + can_eat_plants);
+}
+
+// Skutek eats() dla organizmu o diecie self spotykającego organizm o diecie
+// other, zapisany bitami, żeby dało się go zastosować bez rozgałęzień.
+namespace outcome {
+    constexpr uint8_t gain_all = 1;             // zjada roślinę
+    constexpr uint8_t gain_half_if_stronger = 2; // zjada słabsze zwierzę
+    constexpr uint8_t die = 4;                  // roślina zjadana przez roślinożercę
+    constexpr uint8_t die_unless_stronger = 8;  // walka dwóch mięsożerców
+    constexpr uint8_t die_if_weaker = 16;       // zjadany przez silniejszego
+
+    constexpr uint8_t of(Diet self, Diet other) {
+        const bool self_meat = (uint8_t)self & 2, self_plants = (uint8_t)self & 1, self_plant = self == Diet::plant;
+        const bool other_meat = (uint8_t)other & 2, other_plants = (uint8_t)other & 1, other_plant = other == Diet::plant;
+
+        if (self_plants && other_plant)
+            return gain_all;
+        else if (self_plant && other_plants)
+            return die;
+        else if (self_meat && other_meat)
+            return gain_half_if_stronger | die_unless_stronger;
+        else if (self_meat && !other_plant)
+            return gain_half_if_stronger;
+        else if (other_meat && !self_plant)
+            return die_if_weaker;
+        return 0;
+    }
+
+    constexpr auto table = [] {
+        std::array<std::array<uint8_t, 4>, 4> result{};
+        for (uint8_t self = 0; self < 4; self++)
+            for (uint8_t other = 0; other < 4; other++)
+                result[self][other] = of(Diet(self), Diet(other));
+        return result;
+    }();
+
+    // Nowa witalność zjadającego według skutku, bez rozgałęzień.
+    constexpr uint64_t apply(uint8_t flags, uint64_t vitality, uint64_t other_vitality) {
+        const uint64_t stronger = vitality > other_vitality;
+        const uint64_t weaker = other_vitality > vitality;
+        const uint64_t gain = (other_vitality & -(uint64_t)(flags & gain_all))
+                + ((other_vitality / 2) & -((flags >> 1) & stronger));
+        const uint64_t dies = ((flags >> 2) & 1) | ((flags >> 3) & 1 & (stronger ^ 1)) | ((flags >> 4) & weaker);
+        return (vitality + gain) & (dies - 1);
+    }
+}
 
 template<typename species_t, bool can_eat_meat, bool can_eat_plants> requires std::equality_comparable<species_t>
 class Organism {
@@ -31,28 +95,29 @@ class Organism {
             return !can_eat_meat && !can_eat_plants;
         }
 
+        // Skutek jest odczytywany ze wspólnej tablicy skutków w czasie
+        // kompilacji, więc każda para diet zawiera tylko swoje przypadki
+        // (outcome::apply służy jedynie encounter_kernel).
         template<bool can_eat_meat2, bool can_eat_plants2>
         constexpr Organism eats(Organism<species_t, can_eat_meat2, can_eat_plants2> organism1) {
+            constexpr uint8_t flags = outcome::table[(uint8_t)diet_of(can_eat_meat, can_eat_plants)]
+                                                    [(uint8_t)diet_of(can_eat_meat2, can_eat_plants2)];
+            const uint64_t other = organism1.get_vitality();
             uint64_t newVitality = vitality;
-
-            if (can_eat_plants && organism1.is_plant()) // roślinożerca zjada roślinę
-                newVitality += organism1.get_vitality();
-            else if (is_plant() && can_eat_plants2) // roślinożerca zjada roślinę
-                newVitality = 0;
-            else if constexpr (can_eat_meat && can_eat_meat2) { // oba nawzajem mogą siebie zjeść
-                if (vitality > organism1.get_vitality())
-                    newVitality += organism1.get_vitality() / 2;
-                else
+            if constexpr (flags & outcome::gain_all)
+                newVitality += other;
+            if (vitality > other) {
+                if constexpr (flags & outcome::gain_half_if_stronger)
+                    newVitality += other / 2;
+            } else {
+                if constexpr (flags & outcome::die_unless_stronger)
                     newVitality = 0;
             }
-            else if (can_eat_meat && !organism1.is_plant()) { // pierwszy może zjeść drugiego a drugi nie może pierwszego
-                if (vitality > organism1.get_vitality())
-                    newVitality += organism1.get_vitality() / 2;
-            }
-            else if (can_eat_meat2 && !is_plant()) { // drugi może zjeść pierwszego a pierwszy nie może drugiego
-                if (organism1.get_vitality() > vitality)
+            if constexpr (flags & outcome::die)
+                newVitality = 0;
+            if constexpr (flags & outcome::die_if_weaker)
+                if (other > vitality)
                     newVitality = 0;
-            }
             return {species, newVitality};
         }
 };
@@ -104,4 +169,42 @@ encounter_series(Organism<species_t, sp1_eats_m, sp1_eats_p> organism1, Args ...
     return (organism1 + ... + args);
 }
 
+// Organizm o diecie znanej dopiero w czasie wykonania.
+template<typename species_t>
+using AnyOrganism = std::variant<Carnivore<species_t>, Omnivore<species_t>, Herbivore<species_t>, Plant<species_t>>;
+
+// Wersja encounter_series dla ciągu organizmów o długości znanej dopiero
+// w czasie wykonania. Elementami mogą być organizmy jednego typu albo
+// AnyOrganism. Przerywa przeglądanie, gdy organism1 zginie. Ciąg roślin dla
+// rośliny organism1 jest błędem kompilacji, a spotkanie dwóch roślin
+// z AnyOrganism zgłasza std::invalid_argument.
+template<typename species_t, bool sp1_eats_m, bool sp1_eats_p, std::input_iterator It, std::sentinel_for<It> S>
+constexpr Organism<species_t, sp1_eats_m, sp1_eats_p>
+encounter_series(Organism<species_t, sp1_eats_m, sp1_eats_p> organism1, It first, S last) {
+    using namespace operators;
+    if constexpr (!std::same_as<std::iter_value_t<It>, AnyOrganism<species_t>>)
+        static_assert(sp1_eats_m || sp1_eats_p || !std::same_as<std::iter_value_t<It>, Plant<species_t>>,
+                      "rośliny nie mogą się spotkać");
+    std::optional<Organism<species_t, sp1_eats_m, sp1_eats_p>> result(organism1);
+    auto meet = [&]<bool sp2_eats_m, bool sp2_eats_p>(Organism<species_t, sp2_eats_m, sp2_eats_p> const &organism2) {
+        if constexpr (!sp1_eats_m && !sp1_eats_p && !sp2_eats_m && !sp2_eats_p)
+            throw std::invalid_argument("rośliny nie mogą się spotkać");
+        else
+            result.emplace(*result + organism2);
+    };
+    for (; first != last && !result->is_dead(); ++first) {
+        if constexpr (std::same_as<std::iter_value_t<It>, AnyOrganism<species_t>>)
+            std::visit(meet, *first);
+        else
+            meet(*first);
+    }
+    return *result;
+}
+
+template<typename species_t, bool sp1_eats_m, bool sp1_eats_p, std::ranges::input_range R>
+constexpr Organism<species_t, sp1_eats_m, sp1_eats_p>
+encounter_series(Organism<species_t, sp1_eats_m, sp1_eats_p> organism1, R &&organisms) {
+    return encounter_series(organism1, std::ranges::begin(organisms), std::ranges::end(organisms));
+}
+
 #endif
@@ -0,0 +1,289 @@
+#ifndef ORGANISM_POPULATION_H
+#define ORGANISM_POPULATION_H
+
+#include "organism.h"
+
+#include <cstdint>
+#include <concepts>
+#include <compare>
+#include <vector>
+#include <span>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <variant>
+
+template<typename T> requires std::totally_ordered<T>
+class SpeciesTable;
+
+// Gatunek zapisany jako numer w tablicy gatunków. Porównanie gatunków to
+// porównanie liczb, a Organism z takim gatunkiem jest trywialnie kopiowalny.
+template<typename T>
+class InternedSpecies {
+    private:
+        uint32_t number;
+
+        constexpr explicit InternedSpecies(uint32_t number) : number(number) {}
+
+        friend class SpeciesTable<T>;
+    public:
+        constexpr uint32_t id() const {
+            return number;
+        }
+
+        constexpr bool operator==(InternedSpecies const &other) const = default;
+
+        // Porządek numerów, czyli kolejności wprowadzania do tablicy gatunków,
+        // a nie porządek samych gatunków.
+        constexpr auto operator<=>(InternedSpecies const &other) const = default;
+};
+
+template<typename T>
+struct std::hash<InternedSpecies<T>> {
+    size_t operator()(InternedSpecies<T> const &sp) const noexcept {
+        return std::hash<uint32_t>{}(sp.id());
+    }
+};
+
+// Tablica gatunków przydzielająca kolejne numery różnym gatunkom. Można
+// korzystać z osobnej tablicy dla każdej symulacji albo z global().
+// Bezpieczna przy użyciu z wielu wątków.
+template<typename T> requires std::totally_ordered<T>
+class SpeciesTable {
+    private:
+        std::map<T, uint32_t> numbers;
+        std::deque<T const *> species;
+        mutable std::mutex mutex;
+    public:
+        InternedSpecies<T> intern(T const &sp) {
+            std::lock_guard lock(mutex);
+            auto [it, inserted] = numbers.try_emplace(sp, (uint32_t)species.size());
+            if (inserted) {
+                try {
+                    species.push_back(&it->first);
+                } catch (...) {
+                    numbers.erase(it);
+                    throw;
+                }
+            }
+            return InternedSpecies<T>(it->second);
+        }
+
+        T const &get(InternedSpecies<T> sp) const {
+            std::lock_guard lock(mutex);
+            return *species.at(sp.id());
+        }
+
+        size_t size() const {
+            std::lock_guard lock(mutex);
+            return species.size();
+        }
+
+        static SpeciesTable &global() {
+            static SpeciesTable table;
+            return table;
+        }
+};
+
+static_assert(std::is_trivially_copyable_v<Omnivore<InternedSpecies<int>>>);
+
+// Kolumnowy zapis par spotykających się organizmów (gatunki jako numery).
+struct EncounterBatch {
+    std::vector<Diet> diet1, diet2;
+    std::vector<uint32_t> species1, species2;
+    std::vector<uint64_t> vitality1, vitality2;
+    std::vector<uint8_t> mated;
+
+    size_t size() const {
+        return diet1.size();
+    }
+
+    void push_back(Diet d1, uint32_t s1, uint64_t v1, Diet d2, uint32_t s2, uint64_t v2) {
+        diet1.push_back(d1);
+        diet2.push_back(d2);
+        species1.push_back(s1);
+        species2.push_back(s2);
+        vitality1.push_back(v1);
+        vitality2.push_back(v2);
+    }
+};
+
+// Rozstrzyga wszystkie spotkania z batch tak jak encounter, bez rozgałęzień
+// zależnych od danych. Witalności są nadpisywane, a mated[i] mówi, czy
+// spotkanie i zakończyło się narodzinami dziecka o witalności
+// mating_vitality(vitality1[i], vitality2[i]) (sprzed spotkania - gody ich
+// nie zmieniają). Nie sprawdza, czy spotykają się dwie rośliny.
+inline void encounter_kernel(EncounterBatch &batch) {
+    batch.mated.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+        const uint64_t v1 = batch.vitality1[i], v2 = batch.vitality2[i];
+        const uint8_t d1 = (uint8_t)batch.diet1[i], d2 = (uint8_t)batch.diet2[i];
+        const uint64_t dead = (v1 == 0) | (v2 == 0);
+        const uint64_t mate = (batch.species1[i] == batch.species2[i]) & (d1 == d2);
+        const uint64_t keep = -(dead | mate);
+        batch.vitality1[i] = (v1 & keep) | (outcome::apply(outcome::table[d1][d2], v1, v2) & ~keep);
+        batch.vitality2[i] = (v2 & keep) | (outcome::apply(outcome::table[d2][d1], v2, v1) & ~keep);
+        batch.mated[i] = (uint8_t)(mate & (dead ^ 1));
+    }
+}
+
+constexpr uint64_t mating_vitality(uint64_t vitality1, uint64_t vitality2) {
+    return std::midpoint(std::min(vitality1, vitality2), std::max(vitality1, vitality2));
+}
+
+template<typename T>
+concept hashable = requires(T const &t) {
+    { std::hash<T>{}(t) } -> std::convertible_to<size_t>;
+};
+
+// Populacja organizmów przechowywana kolumnami (numer gatunku, witalność,
+// dieta). Spotkania z jednego kroku są rozstrzygane równolegle przez
+// encounter_kernel według tych samych reguł co encounter.
+template<typename species_t> requires std::equality_comparable<species_t>
+class Population {
+    private:
+        // Numery gatunków są wyszukiwane w mapie haszującej lub uporządkowanej,
+        // jeśli species_t na to pozwala, a w przeciwnym razie liniowo.
+        using species_index_t = std::conditional_t<hashable<species_t>,
+                std::unordered_map<species_t, uint32_t>,
+                std::conditional_t<std::totally_ordered<species_t>,
+                        std::map<species_t, uint32_t>, std::monostate>>;
+
+        std::vector<species_t> species_table;
+        species_index_t species_index;
+        std::vector<uint32_t> species;
+        std::vector<uint64_t> vitality;
+        std::vector<Diet> diets;
+
+        uint32_t intern(species_t const &sp) {
+            const uint32_t number = (uint32_t)species_table.size();
+            if constexpr (std::is_same_v<species_index_t, std::monostate>) {
+                auto it = std::find(species_table.begin(), species_table.end(), sp);
+                if (it != species_table.end())
+                    return (uint32_t)(it - species_table.begin());
+                species_table.push_back(sp);
+            } else {
+                auto it = species_index.find(sp);
+                if (it != species_index.end())
+                    return it->second;
+                species_table.push_back(sp);
+                try {
+                    species_index.emplace(sp, number);
+                } catch (...) {
+                    species_table.pop_back();
+                    throw;
+                }
+            }
+            return number;
+        }
+
+        size_t add_interned(uint32_t sp, Diet diet, uint64_t vit) {
+            species.push_back(sp);
+            try {
+                vitality.push_back(vit);
+                diets.push_back(diet);
+            } catch (...) {
+                species.pop_back();
+                if (vitality.size() > diets.size())
+                    vitality.pop_back();
+                throw;
+            }
+            return species.size() - 1;
+        }
+
+        struct Birth {
+            size_t parent;
+            uint64_t vitality;
+        };
+
+    public:
+        using id_t = size_t;
+
+        id_t add(species_t const &sp, Diet diet, uint64_t vit) {
+            return add_interned(intern(sp), diet, vit);
+        }
+
+        template<bool can_eat_meat, bool can_eat_plants>
+        id_t add(Organism<species_t, can_eat_meat, can_eat_plants> const &organism) {
+            return add(organism.get_species(), diet_of(can_eat_meat, can_eat_plants), organism.get_vitality());
+        }
+
+        size_t size() const {
+            return species.size();
+        }
+
+        const species_t &get_species(id_t id) const {
+            return species_table[species[id]];
+        }
+
+        uint64_t get_vitality(id_t id) const {
+            return vitality[id];
+        }
+
+        Diet get_diet(id_t id) const {
+            return diets[id];
+        }
+
+        bool is_dead(id_t id) const {
+            return vitality[id] == 0;
+        }
+
+        // Przeprowadza spotkania podanych par. Każdy organizm może wystąpić
+        // w co najwyżej jednej parze, a rośliny nie mogą się spotkać - w przeciwnym
+        // razie zgłaszany jest std::invalid_argument i populacja się nie zmienia.
+        // Dzieci są dopisywane na koniec populacji; zwraca ich liczbę.
+        size_t step(std::span<const std::pair<id_t, id_t>> pairings,
+                    unsigned threads = std::thread::hardware_concurrency()) {
+            std::vector<bool> paired(size());
+            for (auto [id1, id2] : pairings) {
+                if (id1 >= size() || id2 >= size() || id1 == id2 || paired[id1] || paired[id2])
+                    throw std::invalid_argument("organizm musi wystąpić w co najwyżej jednej parze");
+                if (diets[id1] == Diet::plant && diets[id2] == Diet::plant)
+                    throw std::invalid_argument("rośliny nie mogą się spotkać");
+                paired[id1] = paired[id2] = true;
+            }
+
+            constexpr size_t min_chunk = 1 << 12;
+            threads = (unsigned)std::clamp<size_t>(pairings.size() / min_chunk, 1, std::max(threads, 1u));
+            const size_t chunk = (pairings.size() + threads - 1) / threads;
+            std::vector<std::vector<Birth>> births(threads);
+            auto resolve_chunk = [&](unsigned t) {
+                EncounterBatch batch;
+                for (size_t i = t * chunk; i < std::min(pairings.size(), (t + 1) * chunk); i++) {
+                    auto [id1, id2] = pairings[i];
+                    batch.push_back(diets[id1], species[id1], vitality[id1], diets[id2], species[id2], vitality[id2]);
+                }
+                encounter_kernel(batch);
+                for (size_t j = 0; j < batch.size(); j++) {
+                    auto [id1, id2] = pairings[t * chunk + j];
+                    if (batch.mated[j])
+                        births[t].push_back({id1, mating_vitality(vitality[id1], vitality[id2])});
+                    vitality[id1] = batch.vitality1[j];
+                    vitality[id2] = batch.vitality2[j];
+                }
+            };
+            {
+                std::vector<std::jthread> workers;
+                for (unsigned t = 1; t < threads; t++)
+                    workers.emplace_back(resolve_chunk, t);
+                resolve_chunk(0);
+            }
+
+            size_t born = 0;
+            for (auto const &thread_births : births) {
+                for (Birth const &birth : thread_births) {
+                    add_interned(species[birth.parent], diets[birth.parent], birth.vitality);
+                    born++;
+                }
+            }
+            return born;
+        }
+};
+
+#endif
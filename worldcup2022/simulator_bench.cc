@@ -0,0 +1,27 @@
+// Liczba gier na sekundę w WorldCup2022Simulator dla jednego wątku i dla
+// wszystkich rdzeni. Wymaga nagłówka worldcup.h z treści zadania.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -pthread simulator_bench.cc -o simulator_bench
+//   ./simulator_bench [liczba_graczy] [liczba_rund] [liczba_gier]
+
+#include "worldcup2022.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char *argv[]) {
+    size_t players = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    unsigned int rounds = argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 100;
+    size_t games = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000000;
+
+    std::printf("players %zu rounds %u games %zu\n", players, rounds, games);
+    for (unsigned int threads: {1u, std::max(std::thread::hardware_concurrency(), 1u)}) {
+        auto start = std::chrono::steady_clock::now();
+        WorldCup2022Simulator::Stats stats = WorldCup2022Simulator::simulate(players, rounds, games, 2022, threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("threads %3u %12.0f games/s  mean rounds %.2f  no winner %.4f  seat 0 wins %.4f\n",
+                    threads, (double) games / seconds, stats.meanRounds, stats.noWinnerRate, stats.winRate[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Sprawdza, że rozgrywka z StatusScoreBoard (bez ScoreBoard) nie alokuje
+// pamięci w trakcie tur. Gry 11 graczy na 10000 rund są rozgrywane z kolejnymi
+// ziarnami, dopóki nie uzbiera się co najmniej 11 * 10000 tur. Wymaga nagłówka
+// worldcup.h z treści zadania.
+//
+//   g++ -std=c++20 -O2 status_alloc_check.cc -o status_alloc_check
+//   ./status_alloc_check
+
+#include "worldcup2022.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// GCC po wstawieniu zastąpionego operator new uznaje free na jego wyniku za
+// niedopasowaną dealokację.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+    size_t allocations = 0;
+    bool counting = false;
+
+}
+
+void *operator new(size_t size) {
+    if (counting)
+        allocations++;
+    if (void *ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+    class CountingStatusBoard : public StatusScoreBoard {
+    public:
+        size_t turns = 0;
+        size_t characters = 0;
+
+        void onRound([[maybe_unused]] unsigned int roundNo) override {}
+
+        void onTurn(std::string_view playerName, [[maybe_unused]] PlayerStatus status,
+                    [[maybe_unused]] unsigned int waitingTurns, std::string_view squareName,
+                    [[maybe_unused]] unsigned int money) override {
+            turns++;
+            characters += playerName.size() + squareName.size();
+        }
+
+        void onWin(std::string_view playerName) override {
+            characters += playerName.size();
+        }
+    };
+
+}
+
+int main() {
+    constexpr size_t players = 11;
+    constexpr unsigned int rounds = 10000;
+    size_t turns = 0, games = 0;
+    for (uint64_t seed = 0; turns < players * rounds; seed++, games++) {
+        WorldCup2022 worldCup;
+        std::shared_ptr<Die> die = std::make_shared<SplitMixDie>(seed);
+        worldCup.addDie(die);
+        worldCup.addDie(die);
+        for (size_t i = 0; i < players; i++) {
+            // Nazwy dłuższe niż bufor małych napisów std::string.
+            worldCup.addPlayer("Gracz o dość długiej nazwie numer " + std::to_string(i));
+        }
+        auto board = std::make_shared<CountingStatusBoard>();
+        worldCup.setStatusScoreBoard(board);
+
+        counting = true;
+        worldCup.play(rounds);
+        counting = false;
+        turns += board->turns;
+    }
+
+    std::printf("games %zu turns %zu allocations %zu\n", games, turns, allocations);
+    return allocations == 0 ? 0 : 1;
+}
@@ -3,6 +3,30 @@
 
 #include "worldcup.h"
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <climits>
+#include <string_view>
+#include <atomic>
+#include <span>
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+#include <optional>
+#include <istream>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <chrono>
+
+// Z WORLDCUP2022_TRACE gra mierzy czasy akcji pól, rzutów kostkami i wywołań
+// tablic wyników oraz zapisuje dziennik ruchów. Bez tej flagi pomiary nie są
+// kompilowane.
+#ifdef WORLDCUP2022_TRACE
+#define WORLDCUP2022_PROFILE(timing) WorldCupProfile::Scope profileScope(profile.timing)
+#else
+#define WORLDCUP2022_PROFILE(timing)
+#endif
 
 class TooManyPlayersException : public std::exception {
 };
@@ -16,6 +40,69 @@ class TooFewPlayersException : public std::exception {
 class TooFewDiceException : public std::exception {
 };
 
+// Ograniczenia liczby graczy i kostek sprawdzane przez play(). Domyślne
+// wartości to zasady standardowej gry. Gra z więcej niż GameState::maxPlayers
+// graczami albo na planszy z więcej niż GameState::maxFields polami toczy się
+// normalnie, ale nie da się zapisać jej przez snapshot() - kopie takiej gry
+// tworzy fork().
+struct WorldCupRules {
+    size_t minPlayers = 2;
+    size_t maxPlayers = 11;
+    size_t minDice = 2;
+    size_t maxDice = 2;
+};
+
+enum class PlayerStatus : uint8_t {
+    playing,
+    waiting,
+    bankrupt
+};
+
+// Tablica wyników dostająca stan gracza jako wartość wyliczeniową i liczbę
+// tur oczekiwania zamiast gotowego napisu. Napisy przekazywane są przez
+// std::string_view, więc raportowanie nie wymaga alokacji pamięci.
+class StatusScoreBoard {
+public:
+    virtual ~StatusScoreBoard() = default;
+
+    virtual void onRound(unsigned int roundNo) = 0;
+
+    // waitingTurns ma znaczenie tylko dla PlayerStatus::waiting.
+    virtual void onTurn(std::string_view playerName, PlayerStatus status, unsigned int waitingTurns,
+                        std::string_view squareName, unsigned int money) = 0;
+
+    virtual void onWin(std::string_view playerName) = 0;
+};
+
+// Stan rozgrywki na standardowej planszy, trywialnie kopiowalny, więc można
+// go tanio kopiować i przekazywać między wątkami.
+struct GameState {
+    static constexpr size_t maxPlayers = 11;
+    static constexpr size_t maxFields = 12;
+
+    struct PlayerState {
+        size_t field = 0;
+        unsigned int wallet = 0;
+        unsigned int state = 0;
+        bool isBankrupt = false;
+    };
+
+    struct FieldState {
+        size_t collected = 0;
+        int playerCounter = 0;
+    };
+
+    size_t playersNumber = 0;
+    size_t fieldsNumber = 0;
+    size_t bankruptNumber = 0;
+    size_t bankruptIndexSum = 0;
+    size_t roundsPlayed = 0;
+    std::array<PlayerState, maxPlayers> players{};
+    std::array<FieldState, maxFields> fields{};
+};
+
+static_assert(std::is_trivially_copyable_v<GameState>);
+
 class Player {
 private :
     std::string const name;
@@ -60,7 +147,7 @@ public:
         state = fine;
     }
 
-    std::string getName() const {
+    const std::string &getName() const {
         return name;
     }
 
@@ -76,6 +163,21 @@ public:
         currentlyField = (currentlyField + 1) % boardSize;
     }
 
+    GameState::PlayerState getState() const {
+        return {currentlyField, wallet, state, isBankrupt};
+    }
+
+    void setState(const GameState::PlayerState &playerState) {
+        currentlyField = playerState.field;
+        wallet = playerState.wallet;
+        state = playerState.state;
+        isBankrupt = playerState.isBankrupt;
+    }
+
+    void moveFields(size_t fields, size_t boardSize) {
+        currentlyField = (currentlyField + fields % boardSize) % boardSize;
+    }
+
     void writeScore(const std::shared_ptr <ScoreBoard> &scoreBoard, std::string const &fieldName) {
         if (isBankrupt) {
             scoreBoard->onTurn(name, "*** bankrut ***", fieldName, 0);
@@ -88,6 +190,40 @@ public:
         }
         scoreBoard->onTurn(name, "w grze", fieldName, wallet);
     }
+
+    void writeStatus(StatusScoreBoard &scoreBoard, std::string_view fieldName) const {
+        if (isBankrupt) {
+            scoreBoard.onTurn(name, PlayerStatus::bankrupt, 0, fieldName, 0);
+        } else if (state > 0) {
+            scoreBoard.onTurn(name, PlayerStatus::waiting, state, fieldName, wallet);
+        } else {
+            scoreBoard.onTurn(name, PlayerStatus::playing, 0, fieldName, wallet);
+        }
+    }
+};
+
+enum class FieldType : uint8_t {
+    restDay,
+    seasonBegin,
+    match,
+    penalty,
+    goal,
+    yellowCard,
+    bookmaker,
+    custom      // pole bez własnego opisu, obsługiwane wirtualnymi wywołaniami
+};
+
+// Opis pola jako typ i parametry (oraz stan pól, które go mają), używany przez
+// CompactBoard zamiast wirtualnych wywołań.
+struct FieldData {
+    FieldType type = FieldType::restDay;
+    double weight = 0;     // mecz
+    size_t fee = 0;        // mecz, rzut karny, bukmacher
+    size_t prize = 0;      // gol, bukmacher, premia początku sezonu
+    uint64_t suspension = 0;
+    size_t collected = 0;  // pobrane opłaty za mecz
+    int playerCounter = 0; // bukmacher
+    int playerCycle = 1;   // bukmacher
 };
 
 class Field {
@@ -102,7 +238,13 @@ public:
 
     virtual void landingAction([[maybe_unused]] Player *player) {}
 
-    std::string getName() const {
+    // Pola, które nie nadpisują toData, CompactBoard obsługuje przez
+    // passingAction i landingAction.
+    virtual FieldData toData() const {
+        return FieldData{.type = FieldType::custom};
+    }
+
+    const std::string &getName() const {
         return name;
     }
 };
@@ -127,6 +269,10 @@ public:
         player->addMoney((double) prize * weight);
         prize = 0;
     }
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::match, .weight = weight, .fee = fee, .collected = prize};
+    }
 };
 
 class SeasonBegin : public virtual Field {
@@ -144,6 +290,10 @@ public:
     void landingAction(Player *player) override {
         player->addMoney((double) passBonus);
     }
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::seasonBegin, .prize = passBonus};
+    }
 };
 
 class Penalty : public virtual Field {
@@ -157,6 +307,10 @@ public:
     void landingAction(Player *player) override {
         player->takeMoney(fee);
     }
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::penalty, .fee = fee};
+    }
 };
 
 class Goal : public virtual Field {
@@ -170,6 +324,10 @@ public:
     void landingAction(Player *player) override {
         player->addMoney((double) prize);
     }
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::goal, .prize = prize};
+    }
 };
 
 class YellowCard : public virtual Field {
@@ -183,6 +341,10 @@ public:
     void landingAction(Player *player) override {
         player->setFine(suspension);
     }
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::yellowCard, .suspension = suspension};
+    }
 };
 
 class Bookmaker : public virtual Field {
@@ -206,12 +368,21 @@ public:
         }
         playerCounter = (playerCounter + 1) % playerCycle;
     }
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::bookmaker, .fee = fee, .prize = prize,
+                         .playerCounter = playerCounter, .playerCycle = playerCycle};
+    }
 };
 
 class RestDay : public virtual Field {
 public:
     explicit RestDay(std::string const &name) :
             Field(name) {}
+
+    FieldData toData() const override {
+        return FieldData{.type = FieldType::restDay};
+    }
 };
 
 class Board {
@@ -236,6 +407,51 @@ public:
 
     }
 
+    explicit Board(std::vector <std::shared_ptr<Field>> fields) :
+            fields(std::move(fields)) {
+        if (this->fields.empty()) {
+            throw std::invalid_argument("Board without fields");
+        }
+    }
+
+    // Wczytuje planszę w formacie jedno pole na wiersz:
+    //   seasonBegin|nazwa|premia
+    //   match|nazwa|waga|opłata
+    //   restDay|nazwa
+    //   yellowCard|nazwa|liczba tur
+    //   bookmaker|nazwa|opłata|nagroda
+    //   goal|nazwa|nagroda
+    //   penalty|nazwa|opłata
+    // Puste wiersze i wiersze zaczynające się od # są pomijane.
+    static Board fromStream(std::istream &in) {
+        std::vector <std::shared_ptr<Field>> fields;
+        std::string line;
+        for (size_t lineNo = 1; std::getline(in, line); lineNo++) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::vector <std::string> parts;
+            std::istringstream lineStream(line);
+            for (std::string part; std::getline(lineStream, part, '|');) {
+                parts.push_back(part);
+            }
+            try {
+                fields.push_back(parseField(parts));
+            } catch (const std::logic_error &) {
+                throw std::invalid_argument("Invalid board field in line " + std::to_string(lineNo));
+            }
+        }
+        return Board(std::move(fields));
+    }
+
+    static Board fromFile(const std::string &path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::invalid_argument("Cannot open board file " + path);
+        }
+        return fromStream(in);
+    }
+
     size_t size() const {
         return fields.size();
     }
@@ -243,6 +459,301 @@ public:
     Field *operator[](size_t i) const {
         return fields[i].get();
     }
+
+    std::shared_ptr <Field> getField(size_t i) const {
+        return fields[i];
+    }
+
+private:
+    // Rzuca std::invalid_argument lub std::out_of_range (z std::stoul) przy
+    // błędnym opisie pola.
+    static std::shared_ptr <Field> parseField(const std::vector <std::string> &parts) {
+        auto expect = [&](size_t count) {
+            if (parts.size() != count || parts[1].empty()) {
+                throw std::invalid_argument("Wrong number of parameters");
+            }
+        };
+        auto number = [&](size_t i) -> size_t {
+            size_t pos;
+            unsigned long long value = std::stoull(parts[i], &pos);
+            if (pos != parts[i].size() || parts[i][0] == '-') {
+                throw std::invalid_argument("Not a number");
+            }
+            return value;
+        };
+        const std::string type = parts.empty() ? "" : parts[0];
+        if (type == "seasonBegin") {
+            expect(3);
+            return std::make_shared<SeasonBegin>(parts[1], number(2));
+        } else if (type == "match") {
+            expect(4);
+            size_t pos;
+            double weight = std::stod(parts[2], &pos);
+            if (pos != parts[2].size() || !(weight >= 0)) {
+                throw std::invalid_argument("Not a weight");
+            }
+            return std::make_shared<Match>(parts[1], weight, number(3));
+        } else if (type == "restDay") {
+            expect(2);
+            return std::make_shared<RestDay>(parts[1]);
+        } else if (type == "yellowCard") {
+            expect(3);
+            return std::make_shared<YellowCard>(parts[1], number(2));
+        } else if (type == "bookmaker") {
+            expect(4);
+            return std::make_shared<Bookmaker>(parts[1], number(2), number(3));
+        } else if (type == "goal") {
+            expect(3);
+            return std::make_shared<Goal>(parts[1], number(2));
+        } else if (type == "penalty") {
+            expect(3);
+            return std::make_shared<Penalty>(parts[1], number(2));
+        }
+        throw std::invalid_argument("Unknown field type");
+    }
+};
+
+// Plansza zapisana jako tablica opisów pól. Akcje pól są wybierane instrukcją
+// switch, bez wirtualnych wywołań i liczników referencji. Stan pól (opłaty
+// za mecze, licznik bukmachera) jest przechowywany w tablicy.
+//
+// Przejście przez wiele pól naraz (passFields) korzysta z sum prefiksowych
+// premii i opłat. Opłaty za mecze nie są od razu dopisywane do pól - liczba
+// przejść przez każde pole jest zapisywana w drzewie Fenwicka i rozliczana
+// dopiero przy zatrzymaniu się na meczu.
+class CompactBoard {
+private:
+    std::vector <FieldData> fields;
+    std::vector <std::string> names;
+    std::vector <uint64_t> bonusPrefix;
+    std::vector <uint64_t> feePrefix;
+    std::vector <uint64_t> customPrefix;
+    std::vector <int64_t> passes;
+    // Obiekty pól typu custom (dla pozostałych pól puste wskaźniki).
+    std::vector <std::shared_ptr<Field>> customFields;
+
+    static uint64_t cyclicSum(const std::vector <uint64_t> &prefix, size_t start, size_t count) {
+        size_t n = prefix.size() - 1;
+        uint64_t sum = prefix[n] * (count / n);
+        count %= n;
+        if (start + count <= n) {
+            return sum + prefix[start + count] - prefix[start];
+        }
+        return sum + prefix[n] - prefix[start] + prefix[start + count - n];
+    }
+
+    void addPasses(size_t i, int64_t count) {
+        for (i++; i < passes.size(); i += i & -i) {
+            passes[i] += count;
+        }
+    }
+
+    void addPasses(size_t start, size_t end, int64_t count) {
+        addPasses(start, count);
+        if (end < fields.size()) {
+            addPasses(end, -count);
+        }
+    }
+
+    int64_t pendingPasses(size_t i) const {
+        int64_t count = 0;
+        for (i++; i > 0; i -= i & -i) {
+            count += passes[i];
+        }
+        return count;
+    }
+
+    void settleMatch(size_t i) {
+        int64_t count = pendingPasses(i);
+        if (count) {
+            fields[i].collected = fields[i].collected + fields[i].fee * (size_t) count;
+            addPasses(i, i + 1, -count);
+        }
+    }
+
+public:
+    explicit CompactBoard(const Board &board) :
+            bonusPrefix(1),
+            feePrefix(1),
+            customPrefix(1),
+            passes(board.size() + 1),
+            customFields(board.size()) {
+        for (size_t i = 0; i < board.size(); i++) {
+            fields.push_back(board[i]->toData());
+            names.push_back(board[i]->getName());
+            bonusPrefix.push_back(bonusPrefix.back() + (fields[i].type == FieldType::seasonBegin ? fields[i].prize : 0));
+            feePrefix.push_back(feePrefix.back() + (fields[i].type == FieldType::match ? fields[i].fee : 0));
+            customPrefix.push_back(customPrefix.back() + (fields[i].type == FieldType::custom));
+            if (fields[i].type == FieldType::custom) {
+                customFields[i] = board.getField(i);
+            }
+        }
+    }
+
+    // Stanu pól typu custom nie da się zapisać ani skopiować.
+    bool hasCustomFields() const {
+        return customPrefix.back() > 0;
+    }
+
+    size_t size() const {
+        return fields.size();
+    }
+
+    // Opis pola wraz z nierozliczonymi jeszcze opłatami za mecz.
+    FieldData operator[](size_t i) const {
+        FieldData field = fields[i];
+        if (field.type == FieldType::match) {
+            field.collected = field.collected + field.fee * (size_t) pendingPasses(i);
+        }
+        return field;
+    }
+
+    GameState::FieldState getState(size_t i) const {
+        FieldData field = (*this)[i];
+        return {field.collected, field.playerCounter};
+    }
+
+    void setState(size_t i, const GameState::FieldState &fieldState) {
+        settleMatch(i);
+        fields[i].collected = fieldState.collected;
+        fields[i].playerCounter = fieldState.playerCounter;
+    }
+
+    // Wykonuje passingAction na count polach za polem from naraz, o ile
+    // gracz na pewno nie zbankrutuje po drodze i po drodze nie ma pól typu
+    // custom. W przeciwnym razie nic nie robi i zwraca false - wtedy trzeba
+    // przechodzić pole po polu.
+    bool passFields(size_t from, size_t count, Player &player) {
+        if (count == 0) {
+            return true;
+        }
+        size_t start = (from + 1) % size();
+        if (cyclicSum(customPrefix, start, count)) {
+            return false;
+        }
+        uint64_t bonus = cyclicSum(bonusPrefix, start, count);
+        uint64_t fees = cyclicSum(feePrefix, start, count);
+        uint64_t wallet = player.getWallet();
+        if (wallet < fees || bonus > UINT_MAX - wallet) {
+            return false;
+        }
+        player.addMoney((double) bonus);
+        player.takeMoney(fees);
+        if (count / size()) {
+            addPasses(0, size(), (int64_t) (count / size()));
+        }
+        size_t rest = count % size();
+        if (start + rest <= size()) {
+            addPasses(start, start + rest, 1);
+        } else {
+            addPasses(start, size(), 1);
+            addPasses(0, start + rest - size(), 1);
+        }
+        return true;
+    }
+
+    const std::string &getName(size_t i) const {
+        return names[i];
+    }
+
+    FieldType getType(size_t i) const {
+        return fields[i].type;
+    }
+
+    void passingAction(size_t i, Player &player) {
+        FieldData &field = fields[i];
+        switch (field.type) {
+            case FieldType::seasonBegin:
+                player.addMoney((double) field.prize);
+                break;
+            case FieldType::match:
+                field.collected = field.collected + player.takeMoney(field.fee);
+                break;
+            case FieldType::custom:
+                customFields[i]->passingAction(&player);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void landingAction(size_t i, Player &player) {
+        FieldData &field = fields[i];
+        switch (field.type) {
+            case FieldType::seasonBegin:
+            case FieldType::goal:
+                player.addMoney((double) field.prize);
+                break;
+            case FieldType::match:
+                settleMatch(i);
+                player.addMoney((double) field.collected * field.weight);
+                field.collected = 0;
+                break;
+            case FieldType::penalty:
+                player.takeMoney(field.fee);
+                break;
+            case FieldType::yellowCard:
+                player.setFine(field.suspension);
+                break;
+            case FieldType::bookmaker:
+                if (field.playerCounter % field.playerCycle == 0) {
+                    player.addMoney((double) field.prize);
+                } else {
+                    player.takeMoney(field.fee);
+                }
+                field.playerCounter = (field.playerCounter + 1) % field.playerCycle;
+                break;
+            case FieldType::restDay:
+                break;
+            case FieldType::custom:
+                customFields[i]->landingAction(&player);
+                break;
+        }
+    }
+};
+
+// Kostka oparta na liczniku: i-ty rzut to funkcja SplitMix64 od ziarna i i,
+// więc wyniki są powtarzalne dla danego ziarna i można je generować blokami.
+// Licznik jest atomowy, więc z jednej kostki mogą korzystać różne wątki
+// (kolejność rzutów między wątkami nie jest wtedy ustalona).
+class SplitMixDie : public Die {
+private:
+    const uint64_t seed;
+    const unsigned short faces;
+    mutable std::atomic<uint64_t> counter = 0;
+
+public:
+    explicit SplitMixDie(uint64_t seed, unsigned short faces = 6) :
+            seed(seed),
+            faces(faces) {
+        if (faces == 0) {
+            throw std::invalid_argument("Die without faces");
+        }
+    }
+
+    static constexpr uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Wynik index-tego rzutu kostki o danym ziarnie.
+    static constexpr unsigned short rollAt(uint64_t seed, uint64_t index, unsigned short faces = 6) {
+        return (unsigned short) (1 + mix(seed ^ mix(index)) % faces);
+    }
+
+    unsigned short roll() const override {
+        return rollAt(seed, counter.fetch_add(1, std::memory_order_relaxed), faces);
+    }
+
+    // Wypełnia out kolejnymi rzutami, rezerwując je jedną operacją na liczniku.
+    void rollBlock(std::span<unsigned short> out) const {
+        uint64_t first = counter.fetch_add(out.size(), std::memory_order_relaxed);
+        for (size_t i = 0; i < out.size(); i++) {
+            out[i] = rollAt(seed, first + i, faces);
+        }
+    }
 };
 
 class Dice {
@@ -253,7 +764,7 @@ public:
 
     unsigned short roll() {
         unsigned short ret = 0;
-        for (std::shared_ptr <Die> die: dice) {
+        for (const std::shared_ptr <Die> &die: dice) {
             ret += die->roll();
         }
         return ret;
@@ -273,22 +784,288 @@ public:
     }
 };
 
+// Liczba wywołań i łączny czas w nanosekundach dla każdego rodzaju
+// mierzonej operacji.
+struct WorldCupProfile {
+    struct Timing {
+        uint64_t count = 0;
+        uint64_t ns = 0;
+
+        Timing &operator+=(const Timing &other) {
+            count += other.count;
+            ns += other.ns;
+            return *this;
+        }
+    };
+
+    // Dolicza do timing czas od utworzenia do zniszczenia obiektu.
+    class Scope {
+    private:
+        Timing &timing;
+        const std::chrono::steady_clock::time_point start;
+    public:
+        explicit Scope(Timing &timing) :
+                timing(timing),
+                start(std::chrono::steady_clock::now()) {}
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope() {
+            timing.count++;
+            timing.ns += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    static constexpr size_t fieldTypes = (size_t) FieldType::custom + 1;
+
+    std::array<Timing, fieldTypes> passing{}; // przejścia pole po polu
+    std::array<Timing, fieldTypes> landing{};
+    Timing passFields;                        // przejścia wielu pól naraz
+    Timing diceRoll;
+    Timing onRound;                           // obie tablice wyników
+    Timing onTurn;
+    Timing onWin;
+
+    WorldCupProfile &operator+=(const WorldCupProfile &other) {
+        for (size_t i = 0; i < fieldTypes; i++) {
+            passing[i] += other.passing[i];
+            landing[i] += other.landing[i];
+        }
+        passFields += other.passFields;
+        diceRoll += other.diceRoll;
+        onRound += other.onRound;
+        onTurn += other.onTurn;
+        onWin += other.onWin;
+        return *this;
+    }
+};
+
+// Jeden ruch gracza w dzienniku rozgrywki. Dziennik zapisywany jest binarnie,
+// po 24 bajty na ruch, w kolejności bajtów maszyny zapisującej.
+struct MoveEvent {
+    uint32_t round = 0;
+    uint32_t player = 0;
+    uint32_t from = 0;
+    uint32_t to = 0;
+    uint32_t wallet = 0; // po zakończeniu ruchu
+    uint16_t roll = 0;
+    PlayerStatus status = PlayerStatus::playing;
+    uint8_t reserved = 0;
+
+    static void write(std::ostream &out, std::span<const MoveEvent> events) {
+        out.write(reinterpret_cast<const char *>(events.data()),
+                  (std::streamsize) (events.size() * sizeof(MoveEvent)));
+    }
+
+    // Rzuca std::invalid_argument, jeśli dziennik jest ucięty.
+    static std::vector<MoveEvent> read(std::istream &in) {
+        std::vector<MoveEvent> events;
+        MoveEvent event;
+        while (in.read(reinterpret_cast<char *>(&event), sizeof(MoveEvent))) {
+            events.push_back(event);
+        }
+        if (in.gcount() != 0) {
+            throw std::invalid_argument("Truncated move log");
+        }
+        return events;
+    }
+};
+
+static_assert(sizeof(MoveEvent) == 24 && std::is_trivially_copyable_v<MoveEvent>);
+
+// Kostka powtarzająca rzuty z dziennika ruchów. Gra z jedną taką kostką (przy
+// zasadach dopuszczających jedną kostkę), na tej samej planszy i z tymi samymi
+// graczami, przebiega tak samo jak zapisana.
+class ReplayDie : public Die {
+private:
+    std::vector<unsigned short> rolls;
+    mutable size_t next = 0;
+public:
+    explicit ReplayDie(std::span<const MoveEvent> events) {
+        rolls.reserve(events.size());
+        for (const MoveEvent &event: events) {
+            rolls.push_back(event.roll);
+        }
+    }
+
+    // Rzuca std::out_of_range po wyczerpaniu dziennika.
+    unsigned short roll() const override {
+        if (next == rolls.size()) {
+            throw std::out_of_range("Move log exhausted");
+        }
+        return rolls[next++];
+    }
+};
+
 class WorldCup2022 : public WorldCup {
 private :
-    std::vector <std::shared_ptr<Player>> players;
+    std::vector <Player> players;
     std::shared_ptr <ScoreBoard> scoreboard;
+    std::shared_ptr <StatusScoreBoard> statusBoard;
     std::shared_ptr <Dice> dice;
     size_t bankruptNumber = 0;
-    Board board;
+    // Suma indeksów graczy policzonych w bankruptNumber. Gdy zostaje jeden
+    // niepoliczony gracz, jego indeks to suma wszystkich indeksów minus ta.
+    size_t bankruptIndexSum = 0;
+    CompactBoard board{Board()};
+    WorldCupRules rules;
+    size_t roundsPlayed = 0;
+    // Puste, gdy gra się nie skończyła albo skończyła się bez zwycięzcy
+    // (ostatni gracz zbankrutował, stając na polu).
+    std::optional<size_t> winner;
+#ifdef WORLDCUP2022_TRACE
+    WorldCupProfile profile;
+    std::vector<MoveEvent> trace;
+#endif
+
+    // Bez tablicy wyników gra toczy się bez raportowania.
+    void reportWin(size_t index) {
+        winner = index;
+        if (scoreboard) {
+            WORLDCUP2022_PROFILE(onWin);
+            scoreboard->onWin(players[index].getName());
+        }
+        if (statusBoard) {
+            WORLDCUP2022_PROFILE(onWin);
+            statusBoard->onWin(players[index].getName());
+        }
+    }
+
+    // Przesuwa gracza o roll pól, wykonując akcje mijanych pól. Pole po polu
+    // przechodzi tylko wtedy, gdy gracz może zbankrutować po drodze.
+    void move(size_t index, unsigned int roll) {
+        Player &player = players[index];
+        size_t from = player.getCurrField();
+        bool passed;
+        {
+            WORLDCUP2022_PROFILE(passFields);
+            passed = board.passFields(from, roll - 1, player);
+        }
+        if (!passed) {
+            for (size_t i = 1; i < roll; i++) {
+                size_t field = (from + i) % board.size();
+                {
+                    WORLDCUP2022_PROFILE(passing[(size_t) board.getType(field)]);
+                    board.passingAction(field, player);
+                }
+                if (player.getIsBankrupt()) {
+                    ++bankruptNumber;
+                    bankruptIndexSum += index;
+                    break;
+                }
+            }
+        }
+        player.moveFields(roll, board.size());
+    }
+
+    // Gra na kopii gotowej planszy, bez ponownego budowania jej z Board.
+    WorldCup2022(const CompactBoard &gameBoard, WorldCupRules gameRules) :
+            board(gameBoard),
+            rules(gameRules) {
+        dice = std::make_shared<Dice>(Dice());
+    }
+
+    // Kopia gry bez tablic wyników; kostki ustawia wywołujący.
+    WorldCup2022 copyState() const {
+        if (board.hasCustomFields()) {
+            throw std::logic_error("Custom fields cannot be copied");
+        }
+        WorldCup2022 copy(*this);
+        copy.scoreboard.reset();
+        copy.statusBoard.reset();
+        return copy;
+    }
+
+    friend class WorldCup2022Simulator;
 public:
+    // Zapisuje stan gry o co najwyżej GameState::maxPlayers graczach
+    // i GameState::maxFields polach. Dla większej gry zgłasza
+    // std::length_error (taką grę można skopiować przez fork), a dla planszy
+    // z polami typu custom std::logic_error.
+    GameState snapshot() const {
+        GameState state;
+        if (players.size() > GameState::maxPlayers || board.size() > GameState::maxFields) {
+            throw std::length_error("Game too large for a snapshot");
+        }
+        if (board.hasCustomFields()) {
+            throw std::logic_error("Custom fields cannot be saved in a snapshot");
+        }
+        state.playersNumber = players.size();
+        state.fieldsNumber = board.size();
+        state.bankruptNumber = bankruptNumber;
+        state.bankruptIndexSum = bankruptIndexSum;
+        state.roundsPlayed = roundsPlayed;
+        for (size_t i = 0; i < players.size(); i++) {
+            state.players[i] = players[i].getState();
+        }
+        for (size_t i = 0; i < board.size(); i++) {
+            state.fields[i] = board.getState(i);
+        }
+        return state;
+    }
+
+    // Przywraca stan zapisany przez snapshot gry z tą samą liczbą graczy.
+    void restore(const GameState &state) {
+        if (state.playersNumber != players.size() || state.fieldsNumber != board.size()) {
+            throw std::invalid_argument("Snapshot of a different game");
+        }
+        if (board.hasCustomFields()) {
+            throw std::logic_error("Custom fields cannot be restored from a snapshot");
+        }
+        bankruptNumber = state.bankruptNumber;
+        bankruptIndexSum = state.bankruptIndexSum;
+        roundsPlayed = state.roundsPlayed;
+        winner.reset();
+        for (size_t i = 0; i < players.size(); i++) {
+            players[i].setState(state.players[i]);
+        }
+        for (size_t i = 0; i < board.size(); i++) {
+            board.setState(i, state.fields[i]);
+        }
+    }
+
+    // Niezależna kopia gry w bieżącym stanie, do rozgrywania wariantów. Kopia
+    // nie ma tablic wyników i korzysta z tych samych obiektów Die co oryginał,
+    // więc przy rozgrywaniu kopii w wielu wątkach kostki muszą to dopuszczać
+    // (jak SplitMixDie). Kopiowane są bezpośrednio gracze, plansza i liczniki,
+    // więc rozmiar gry nie jest ograniczony jak w GameState. Dla planszy
+    // z polami typu custom zgłasza std::logic_error.
+    WorldCup2022 fork() const {
+        WorldCup2022 copy = copyState();
+        copy.dice = std::make_shared<Dice>(*dice);
+        return copy;
+    }
+
+    // Jak fork(), ale kopia rzuca podanymi kostkami zamiast kostek oryginału,
+    // np. SplitMixDie z osobnym ziarnem dla każdego wariantu. Puste wskaźniki
+    // są pomijane jak w addDie, a liczbę kostek sprawdza dopiero play.
+    WorldCup2022 fork(std::span<const std::shared_ptr<Die>> forkDice) const {
+        WorldCup2022 copy = copyState();
+        copy.dice = std::make_shared<Dice>(Dice());
+        for (const std::shared_ptr<Die> &die: forkDice) {
+            copy.addDie(die);
+        }
+        return copy;
+    }
+
     WorldCup2022() {
         dice = std::make_shared<Dice>(Dice());
     }
 
+    // Gra na podanej planszy z podanymi ograniczeniami liczby graczy i kostek
+    // (o rozmiarze gry, którą można zapisać, patrz WorldCupRules).
+    explicit WorldCup2022(const Board &gameBoard, WorldCupRules gameRules = {}) :
+            board(gameBoard),
+            rules(gameRules) {
+        dice = std::make_shared<Dice>(Dice());
+    }
+
     // Dodaje nowego gracza o podanej nazwie.
     void addPlayer(std::string const &name) {
-        std::shared_ptr <Player> playerPtr = std::make_shared<Player>(name);
-        players.push_back(playerPtr);
+        players.emplace_back(name);
     }
 
     void addDie(std::shared_ptr <Die> die) {
@@ -301,16 +1078,32 @@ public:
         scoreboard = sc;
     }
 
+#ifdef WORLDCUP2022_TRACE
+    const WorldCupProfile &getProfile() const {
+        return profile;
+    }
+
+    // Ruchy w kolejności rozegrania, do zapisania przez MoveEvent::write.
+    const std::vector<MoveEvent> &getTrace() const {
+        return trace;
+    }
+#endif
+
+    // Konfiguruje dodatkową tablicę wyników bez alokacji przy raportowaniu.
+    void setStatusScoreBoard(std::shared_ptr <StatusScoreBoard> sc) {
+        statusBoard = sc;
+    }
+
     // Zakładamy że po zakończeniu rozgrywki będzie tylko jeden zwycięzca,
     // nie będzie remisów.
     void findWinner() {
-        Player *winner = players[0].get();
-        for (const std::shared_ptr <Player> &player: players) {
-            if (player->getWallet() > winner->getWallet()) {
-                winner = player.get();
+        size_t best = 0;
+        for (size_t i = 0; i < players.size(); i++) {
+            if (players[i].getWallet() > players[best].getWallet()) {
+                best = i;
             }
         }
-        scoreboard->onWin(winner->getName());
+        reportWin(best);
     }
 
     // Przeprowadza rozgrywkę co najwyżej podanej liczby rund (rozgrywka może
@@ -327,55 +1120,78 @@ public:
     // rozpoczęcie gry.
     // Wyjątki powinny dziedziczyć po std::exception.
     void play(unsigned int rounds) {
-        if (dice->getNumberOfDices() < 2) {
+        if (dice->getNumberOfDices() < rules.minDice) {
             throw TooFewDiceException();
-        } else if (dice->getNumberOfDices() > 2) {
+        } else if (dice->getNumberOfDices() > rules.maxDice) {
             throw TooManyDiceException();
         }
-        if (players.size() < 2) {
+        if (players.size() < std::max<size_t>(rules.minPlayers, 2)) {
             throw TooFewPlayersException();
-        } else if (players.size() > 11) {
+        } else if (players.size() > rules.maxPlayers) {
             throw TooManyPlayersException();
         }
 
         // Zakładamy, że osoba, która zbankrutowała nadal jest w grze,
         // więc po zakończeniu każdej tury wypisze się, że jest bankrutem.
         for (unsigned int roundNo = 0; roundNo < rounds; roundNo++) {
-            scoreboard->onRound(roundNo);
-            for (const std::shared_ptr <Player> &player: players) {
-                if (!player->getIsBankrupt() && !player->skipsTurn()) {
+            roundsPlayed++;
+            if (scoreboard) {
+                WORLDCUP2022_PROFILE(onRound);
+                scoreboard->onRound(roundNo);
+            }
+            if (statusBoard) {
+                WORLDCUP2022_PROFILE(onRound);
+                statusBoard->onRound(roundNo);
+            }
+            for (size_t index = 0; index < players.size(); index++) {
+                Player &player = players[index];
+                if (!player.getIsBankrupt() && !player.skipsTurn()) {
                     //gra
-                    unsigned int roll = dice->roll();
-                    for (size_t i = 1; i + 1 <= roll; i++) {
-                        player->moveOneField(board.size());
-                        board[player->getCurrField()]->passingAction(player.get());
-                        if (player->getIsBankrupt()) {
-                            ++bankruptNumber;
-                            for (size_t j = i; j <= roll - 1; j++) {
-                                player->moveOneField(board.size());
-                            }
-                            break;
-                        }
+#ifdef WORLDCUP2022_TRACE
+                    size_t from = player.getCurrField();
+#endif
+                    unsigned int roll;
+                    {
+                        WORLDCUP2022_PROFILE(diceRoll);
+                        roll = dice->roll();
+                    }
+                    if (roll != 0) {
+                        move(index, roll);
                     }
-                    if (!player->getIsBankrupt()) {
-                        if (roll != 0) {
-                            player->moveOneField(board.size());
-                        }
-                        board[player->getCurrField()]->landingAction(player.get());
+                    if (!player.getIsBankrupt()) {
+                        size_t field = player.getCurrField();
+                        WORLDCUP2022_PROFILE(landing[(size_t) board.getType(field)]);
+                        board.landingAction(field, player);
                     }
+#ifdef WORLDCUP2022_TRACE
+                    trace.push_back(MoveEvent{
+                            .round = (uint32_t) roundNo, .player = (uint32_t) index,
+                            .from = (uint32_t) from, .to = (uint32_t) player.getCurrField(),
+                            .wallet = player.getWallet(), .roll = (uint16_t) roll,
+                            .status = player.getIsBankrupt() ? PlayerStatus::bankrupt
+                                                             : player.skipsTurn() ? PlayerStatus::waiting
+                                                                                  : PlayerStatus::playing});
+#endif
+                }
+                if (scoreboard) {
+                    WORLDCUP2022_PROFILE(onTurn);
+                    player.writeScore(scoreboard, board.getName(player.getCurrField()));
+                }
+                if (statusBoard) {
+                    WORLDCUP2022_PROFILE(onTurn);
+                    player.writeStatus(*statusBoard, board.getName(player.getCurrField()));
                 }
-                player->writeScore(scoreboard, board[player->getCurrField()]->getName());
 
-                if (player->skipsTurn()) {
-                    player->waitOneTurn();
+                if (player.skipsTurn()) {
+                    player.waitOneTurn();
                 }
 
                 // W sytuacji kiedy tylko jeden gracz nie jest bankrutem,
                 // gra się kończy.
                 if (bankruptNumber == players.size() - 1) {
-                    for (const std::shared_ptr <Player> &p: players) {
-                        if (!p->getIsBankrupt())
-                            scoreboard->onWin(p->getName());
+                    size_t last = players.size() * (players.size() - 1) / 2 - bankruptIndexSum;
+                    if (!players[last].getIsBankrupt()) {
+                        reportWin(last);
                     }
                     return;
                 }
@@ -385,4 +1201,129 @@ public:
     }
 };
 
+// Symulacja wielu niezależnych gier bez tablicy wyników, rozłożona na
+// wszystkie rdzenie. Każda gra ma własną kostkę SplitMixDie z ziarnem
+// wyliczonym z seed i numeru gry, rzucaną tyle razy na ruch, ile kostek
+// wymagają zasady, a wyniki są sumowane jako liczby całkowite, więc
+// statystyki nie zależą od liczby wątków. Plansza jest przygotowywana raz
+// i kopiowana do każdej gry.
+class WorldCup2022Simulator {
+private:
+    struct Counts {
+        std::vector<size_t> wins;
+        std::vector<size_t> bankruptcies;
+        size_t rounds = 0;
+        size_t noWinner = 0;
+#ifdef WORLDCUP2022_TRACE
+        WorldCupProfile profile;
+#endif
+    };
+
+public:
+    struct Stats {
+        size_t games = 0;
+        std::vector<double> winRate;        // dla każdego miejsca przy stole
+        std::vector<double> bankruptcyRate; // dla każdego miejsca przy stole
+        double meanRounds = 0;
+        double noWinnerRate = 0;            // gry zakończone bez zwycięzcy
+#ifdef WORLDCUP2022_TRACE
+        WorldCupProfile profile;            // suma ze wszystkich gier
+#endif
+    };
+
+    // Plansza z polami typu custom zgłasza std::logic_error, bo stan takich
+    // pól byłby wspólny dla wszystkich gier.
+    static Stats simulate(const Board &gameBoard, WorldCupRules gameRules, size_t playersNumber, unsigned int rounds,
+                          size_t games, uint64_t seed, unsigned int threads = std::thread::hardware_concurrency()) {
+        if (playersNumber < std::max<size_t>(gameRules.minPlayers, 2)) {
+            throw TooFewPlayersException();
+        } else if (playersNumber > gameRules.maxPlayers) {
+            throw TooManyPlayersException();
+        } else if (gameRules.minDice > gameRules.maxDice) {
+            throw TooManyDiceException();
+        }
+        const CompactBoard boardTemplate(gameBoard);
+        if (boardTemplate.hasCustomFields()) {
+            throw std::logic_error("Custom fields cannot be copied");
+        }
+        threads = (unsigned int) std::clamp<size_t>(games, 1, std::max(threads, 1u));
+        std::vector<Counts> counts(threads);
+        for (Counts &c: counts) {
+            c.wins.resize(playersNumber);
+            c.bankruptcies.resize(playersNumber);
+        }
+
+        auto simulateGames = [&](unsigned int t) {
+            for (size_t game = t; game < games; game += threads) {
+                std::shared_ptr<Die> die = std::make_shared<SplitMixDie>(SplitMixDie::mix(seed + game));
+                WorldCup2022 worldCup(boardTemplate, gameRules);
+                for (size_t i = 0; i < gameRules.minDice; i++) {
+                    worldCup.addDie(die);
+                }
+                worldCup.players.reserve(playersNumber);
+                for (size_t i = 0; i < playersNumber; i++) {
+                    worldCup.addPlayer(std::to_string(i));
+                }
+                worldCup.play(rounds);
+                if (worldCup.winner) {
+                    counts[t].wins[*worldCup.winner]++;
+                } else {
+                    counts[t].noWinner++;
+                }
+                for (size_t i = 0; i < playersNumber; i++) {
+                    counts[t].bankruptcies[i] += worldCup.players[i].getIsBankrupt();
+                }
+                counts[t].rounds += worldCup.roundsPlayed;
+#ifdef WORLDCUP2022_TRACE
+                counts[t].profile += worldCup.profile;
+#endif
+            }
+        };
+        {
+            std::vector<std::jthread> workers;
+            for (unsigned int t = 1; t < threads; t++) {
+                workers.emplace_back(simulateGames, t);
+            }
+            simulateGames(0);
+        }
+
+        Stats stats;
+        stats.games = games;
+        stats.winRate.resize(playersNumber);
+        stats.bankruptcyRate.resize(playersNumber);
+        if (games == 0) {
+            return stats;
+        }
+        Counts total;
+        total.wins.resize(playersNumber);
+        total.bankruptcies.resize(playersNumber);
+        for (const Counts &c: counts) {
+            for (size_t i = 0; i < playersNumber; i++) {
+                total.wins[i] += c.wins[i];
+                total.bankruptcies[i] += c.bankruptcies[i];
+            }
+            total.rounds += c.rounds;
+            total.noWinner += c.noWinner;
+#ifdef WORLDCUP2022_TRACE
+            stats.profile += c.profile;
+#endif
+        }
+        for (size_t i = 0; i < playersNumber; i++) {
+            stats.winRate[i] = (double) total.wins[i] / (double) games;
+            stats.bankruptcyRate[i] = (double) total.bankruptcies[i] / (double) games;
+        }
+        stats.meanRounds = (double) total.rounds / (double) games;
+        stats.noWinnerRate = (double) total.noWinner / (double) games;
+        return stats;
+    }
+
+    // Gry na domyślnej planszy z domyślnymi zasadami.
+    static Stats simulate(size_t playersNumber, unsigned int rounds, size_t games, uint64_t seed,
+                          unsigned int threads = std::thread::hardware_concurrency()) {
+        return simulate(Board(), WorldCupRules(), playersNumber, rounds, games, seed, threads);
+    }
+};
+
+#undef WORLDCUP2022_PROFILE
+
 #endif